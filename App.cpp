@@ -5,17 +5,45 @@
 
 #include "scenarios/BirdScenario.h"
 #include "scenarios/BipedScenario.h"
+#include "scenarios/CrowdScenario.h"
 
 const double gFPS = 30;
 
 const cApp::eScene gDefaultScene = cApp::eSceneCurve;
 
+// pose sources that can be picked for the biped scenes, the quaternion keys are listed
+// once for each rotation interpolation
+struct tPoseSourceItem
+{
+	const char* mName;
+	cBipedScenario::ePoseSource mSource;
+	cPoseCurve::eRotInterp mRotInterp;
+};
+
+const tPoseSourceItem gPoseSourceItems[] =
+{
+	{ "Curve", cBipedScenario::ePoseSourceCurve, cPoseCurve::eRotInterpNlerp },
+	{ "Quat (nlerp)", cBipedScenario::ePoseSourceQuat, cPoseCurve::eRotInterpNlerp },
+	{ "Quat (squad)", cBipedScenario::ePoseSourceQuat, cPoseCurve::eRotInterpSquad },
+	{ "Cache", cBipedScenario::ePoseSourceCache, cPoseCurve::eRotInterpNlerp }
+};
+const int gNumPoseSourceItems = sizeof(gPoseSourceItems) / sizeof(gPoseSourceItems[0]);
+
 cApp::cApp(int w, int h, const std::string& title) : nanogui::Screen(Eigen::Vector2i(w, h), title)
 {
 	mGUIWindow = nullptr;
 	mSceneCombo = nullptr;
 	mPlayButton = nullptr;
 	mPlaybackSlider = nullptr;
+	mDeferredDrawBox = nullptr;
+	mCrowdPanel = nullptr;
+	mCrowdSizeBox = nullptr;
+	mCrowdTimingLabel = nullptr;
+	mPosePanel = nullptr;
+	mPoseSourceCombo = nullptr;
+	mInitScene = gDefaultScene;
+	mInitCrowdSize = 0;
+	mEnableDeferredDraw = true;
 	mPrevTime = 0;
 	mEnableAnimation = true;
 }
@@ -25,10 +53,39 @@ cApp::~cApp()
 	mScenario.reset();
 }
 
+void cApp::ParseArgs(int argc, char** argv)
+{
+	// supported arguments
+	// -scene bird|biped|crowd: scene shown at startup
+	// -crowd_size N: number of characters in the crowd scene
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool has_val = i + 1 < argc;
+		if (arg == "-scene" && has_val)
+		{
+			std::string val = argv[++i];
+			bool succ = ParseScene(val, mInitScene);
+			if (!succ)
+			{
+				printf("Unsupported scene %s\n", val.c_str());
+			}
+		}
+		else if (arg == "-crowd_size" && has_val)
+		{
+			mInitCrowdSize = std::atoi(argv[++i]);
+		}
+		else
+		{
+			printf("Unsupported argument %s\n", arg.c_str());
+		}
+	}
+}
+
 void cApp::Init()
 {
 	cDrawUtil::InitDrawUtil();
-	BuildScenario(gDefaultScene);
+	BuildScenario(mInitScene);
 	BuildGUI();
 }
 
@@ -123,12 +180,23 @@ void cApp::BuildScenario(eScene scene)
 	case eSceneCharacter:
 		mScenario = std::unique_ptr<cScenario>(new cBipedScenario());
 		break;
+	case eSceneCrowd:
+	{
+		cCrowdScenario* crowd = new cCrowdScenario();
+		if (mInitCrowdSize > 0)
+		{
+			crowd->SetNumChars(mInitCrowdSize);
+		}
+		mScenario = std::unique_ptr<cScenario>(crowd);
+		break;
+	}
 	default:
 		assert(false); // unsupported scene
 		break;
 	}
 	
 	mScenario->Resize(mSize);
+	mScenario->EnableDeferredDraw(mEnableDeferredDraw);
 	mScenario->Init();
 }
 
@@ -196,10 +264,10 @@ void cApp::BuildGUI()
 	
 	// Add combo box to choose between difference scenes
 	new nanogui::Label(mGUIWindow, "Scene", "sans-bold");
-	mSceneCombo = new nanogui::ComboBox(mGUIWindow, {"Bird", "Biped"});
+	mSceneCombo = new nanogui::ComboBox(mGUIWindow, {"Bird", "Biped", "Crowd"});
 	tComboCallback scene_combo_callback = std::bind(&cApp::SceneComboCallback, this, std::placeholders::_1);
 	mSceneCombo->setCallback(scene_combo_callback);
-	mSceneCombo->setSelectedIndex(gDefaultScene);
+	mSceneCombo->setSelectedIndex(mInitScene);
 
 	// Add combo box to pick between different parameter files
 	new nanogui::Label(mGUIWindow, "Param File", "sans-bold");
@@ -237,6 +305,31 @@ void cApp::BuildGUI()
 	mPlaybackSlider->setCallback(std::bind(&cApp::PlaybackSliderCallback, this, std::placeholders::_1));
 	mPlaybackSlider->setFinalCallback(std::bind(&cApp::PlaybackSliderFinalCallback, this, std::placeholders::_1));
 
+	// Toggles between batching the primitives of a frame and drawing each one immediately
+	mDeferredDrawBox = new nanogui::CheckBox(mGUIWindow, "Batch Draw Calls");
+	mDeferredDrawBox->setChecked(mEnableDeferredDraw);
+	tToggleCallback deferred_draw_callback = std::bind(&cApp::DeferredDrawCallback, this, std::placeholders::_1);
+	mDeferredDrawBox->setCallback(deferred_draw_callback);
+
+	// Crowd size and per stage timings, only shown for the crowd scene
+	mCrowdPanel = new Widget(mGUIWindow);
+	mCrowdPanel->setLayout(new nanogui::GroupLayout(0));
+	new nanogui::Label(mCrowdPanel, "Crowd Size", "sans-bold");
+	mCrowdSizeBox = new nanogui::IntBox<int>(mCrowdPanel);
+	mCrowdSizeBox->setEditable(true);
+	mCrowdSizeBox->setMinValue(1);
+	mCrowdSizeBox->setCallback(std::bind(&cApp::CrowdSizeCallback, this, std::placeholders::_1));
+	mCrowdTimingLabel = new nanogui::Label(mCrowdPanel, "");
+	UpdateCrowdGUI();
+
+	// Source of the biped poses, only shown for the biped and crowd scenes
+	mPosePanel = new Widget(mGUIWindow);
+	mPosePanel->setLayout(new nanogui::GroupLayout(0));
+	new nanogui::Label(mPosePanel, "Pose Source", "sans-bold");
+	mPoseSourceCombo = new nanogui::ComboBox(mPosePanel);
+	mPoseSourceCombo->setCallback(std::bind(&cApp::PoseSourceCallback, this, std::placeholders::_1));
+	UpdatePoseGUI();
+
 	// After all GUI has been built, call refresh to reorganize everything
 	RefreshGUI();
 }
@@ -247,6 +340,12 @@ void cApp::UpdateGUI()
 	{
 		double progress = mScenario->GetPlaybackProgress();
 		mPlaybackSlider->setValue(static_cast<float>(progress));
+
+		const cCrowdScenario* crowd = dynamic_cast<const cCrowdScenario*>(mScenario.get());
+		if (crowd != nullptr && mCrowdTimingLabel != nullptr)
+		{
+			mCrowdTimingLabel->setCaption(crowd->GetTimingSummary());
+		}
 	}
 }
 
@@ -265,9 +364,49 @@ void cApp::UpdateParamFileCombo()
 	mParamFileCombo->setSelectedIndex(0);
 }
 
+void cApp::UpdateCrowdGUI()
+{
+	const cCrowdScenario* crowd = dynamic_cast<const cCrowdScenario*>(mScenario.get());
+	mCrowdPanel->setVisible(crowd != nullptr);
+	if (crowd != nullptr)
+	{
+		mCrowdSizeBox->setValue(crowd->GetNumChars());
+	}
+}
+
+void cApp::UpdatePoseGUI()
+{
+	// lists the pose sources supported by the scene and selects the one the scene is using
+	const cBipedScenario* biped = dynamic_cast<const cBipedScenario*>(mScenario.get());
+	mPosePanel->setVisible(biped != nullptr);
+	if (biped != nullptr)
+	{
+		std::vector<std::string> names;
+		int selected = 0;
+		mPoseSourceItems.clear();
+		for (int i = 0; i < gNumPoseSourceItems; ++i)
+		{
+			const tPoseSourceItem& item = gPoseSourceItems[i];
+			if (biped->IsPoseSourceSupported(item.mSource))
+			{
+				bool is_curr = item.mSource == biped->GetPoseSource()
+							&& (item.mSource != cBipedScenario::ePoseSourceQuat || item.mRotInterp == biped->GetRotInterp());
+				if (is_curr)
+				{
+					selected = static_cast<int>(mPoseSourceItems.size());
+				}
+				mPoseSourceItems.push_back(i);
+				names.push_back(item.mName);
+			}
+		}
+		mPoseSourceCombo->setItems(names);
+		mPoseSourceCombo->setSelectedIndex(selected);
+	}
+}
+
 cApp::eScene cApp::GetCurrScene() const
 {
-	eScene scene = gDefaultScene;
+	eScene scene = mInitScene;
 	if (mSceneCombo != nullptr)
 	{
 		scene = static_cast<eScene>(mSceneCombo->selectedIndex());
@@ -288,6 +427,8 @@ void cApp::SceneComboCallback(int i)
 	eScene scene = static_cast<eScene>(i);
 	BuildScenario(scene);
 	UpdateParamFileCombo();
+	UpdateCrowdGUI();
+	UpdatePoseGUI();
 	RefreshGUI();
 }
 
@@ -342,10 +483,70 @@ void cApp::PlaybackSliderFinalCallback(double val)
 	mEnableAnimation = true;
 }
 
+void cApp::CrowdSizeCallback(int num_chars)
+{
+	cCrowdScenario* crowd = dynamic_cast<cCrowdScenario*>(mScenario.get());
+	if (crowd != nullptr)
+	{
+		crowd->SetNumChars(num_chars);
+		mCrowdSizeBox->setValue(crowd->GetNumChars());
+	}
+}
+
+void cApp::PoseSourceCallback(int i)
+{
+	cBipedScenario* biped = dynamic_cast<cBipedScenario*>(mScenario.get());
+	if (biped != nullptr && i >= 0 && i < static_cast<int>(mPoseSourceItems.size()))
+	{
+		const tPoseSourceItem& item = gPoseSourceItems[mPoseSourceItems[i]];
+		biped->SetRotInterp(item.mRotInterp);
+		biped->SetPoseSource(item.mSource);
+		StepScenario(0);
+	}
+}
+
+void cApp::DeferredDrawCallback(bool enable)
+{
+	mEnableDeferredDraw = enable;
+	if (mScenario != nullptr)
+	{
+		mScenario->EnableDeferredDraw(enable);
+	}
+}
+
 void cApp::Reload()
 {
+	if (GetCurrScene() == eSceneCrowd)
+	{
+		// keep the crowd size chosen in the GUI
+		mInitCrowdSize = mCrowdSizeBox->value();
+	}
 	BuildScenario(GetCurrScene());
 	mScenario->LoadParams(GetCurrParamFile());
+	UpdatePoseGUI();
+	RefreshGUI();
+}
+
+bool cApp::ParseScene(const std::string& str, eScene& out_scene) const
+{
+	bool succ = true;
+	if (str == "bird")
+	{
+		out_scene = eSceneCurve;
+	}
+	else if (str == "biped")
+	{
+		out_scene = eSceneCharacter;
+	}
+	else if (str == "crowd")
+	{
+		out_scene = eSceneCrowd;
+	}
+	else
+	{
+		succ = false;
+	}
+	return succ;
 }
 
 void cApp::BuildShortFileNames(const std::vector<std::string>& files, std::vector<std::string>& out_names) const
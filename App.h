@@ -3,7 +3,10 @@
 #include <nanogui/window.h>
 #include <nanogui/button.h>
 #include <nanogui/combobox.h>
+#include <nanogui/checkbox.h>
 #include <nanogui/slider.h>
+#include <nanogui/textbox.h>
+#include <nanogui/label.h>
 
 #include <iostream>
 #include <string>
@@ -18,12 +21,14 @@ public:
 	{
 		eSceneCurve,
 		eSceneCharacter,
+		eSceneCrowd,
 		eSceneMax
 	};
 	
 	cApp(int w, int h, const std::string& title);
 	virtual ~cApp();
 
+	virtual void ParseArgs(int argc, char** argv);
 	virtual void Init();
 
 	virtual bool keyboardEvent(int key, int scancode, int action, int modifiers);
@@ -52,6 +57,17 @@ protected:
 	nanogui::ComboBox* mParamFileCombo;
 	nanogui::Button* mPlayButton;
 	nanogui::Slider* mPlaybackSlider;
+	nanogui::CheckBox* mDeferredDrawBox;
+	nanogui::Widget* mCrowdPanel;
+	nanogui::IntBox<int>* mCrowdSizeBox;
+	nanogui::Label* mCrowdTimingLabel;
+	nanogui::Widget* mPosePanel;
+	nanogui::ComboBox* mPoseSourceCombo;
+	std::vector<int> mPoseSourceItems; // entries of gPoseSourceItems listed in the pose source combo box
+
+	eScene mInitScene;
+	int mInitCrowdSize;
+	bool mEnableDeferredDraw; // kept here so that the setting carries over to newly built scenarios
 
 	double mPrevTime;
 	bool mEnableAnimation;
@@ -70,6 +86,8 @@ protected:
 	virtual void UpdateGUI();
 	virtual void RefreshGUI();
 	virtual void UpdateParamFileCombo();
+	virtual void UpdateCrowdGUI();
+	virtual void UpdatePoseGUI();
 	virtual eScene GetCurrScene() const;
 	virtual const std::string& GetCurrParamFile() const;
 
@@ -80,8 +98,12 @@ protected:
 	virtual void TogglePlayCallback(bool pushed);
 	virtual void PlaybackSliderCallback(double val);
 	virtual void PlaybackSliderFinalCallback(double val);
+	virtual void CrowdSizeCallback(int num_chars);
+	virtual void PoseSourceCallback(int i);
+	virtual void DeferredDrawCallback(bool enable);
 
 	virtual void Reload();
 
+	virtual bool ParseScene(const std::string& str, eScene& out_scene) const;
 	virtual void BuildShortFileNames(const std::vector<std::string>& files, std::vector<std::string>& out_names) const;
 };
\ No newline at end of file
@@ -1,10 +1,21 @@
 #include "ArticulatedFigure.h"
+#include <fstream>
 #include "render/DrawUtil.h"
 
 const int gInvalidJoint = -1;
 const int gRootDOF = 6;
 const int gJointDOF = 3;
 
+const std::string gDefaultSkeletonFile = "data/characters/biped.txt";
+
+const std::string gJointsKey = "Joints";
+const std::string gNameKey = "Name";
+const std::string gParentKey = "Parent";
+const std::string gAttachPtKey = "AttachPt";
+const std::string gLinkAttachPtKey = "LinkAttachPt";
+const std::string gLinkSizeKey = "LinkSize";
+const std::string gColorKey = "Color";
+
 cArticulatedFigure::tJointDef::tJointDef()
 {
 	mParentJoint = gInvalidJoint;
@@ -24,8 +35,16 @@ cArticulatedFigure::tJointDef::tJointDef(int parent, const tVector& attach_pt, c
 	mCol = col;
 }
 
+cArticulatedFigure::tQuatPose::tQuatPose()
+{
+	mRootPos.setZero();
+}
+
 cArticulatedFigure::cArticulatedFigure()
 {
+	mNumDOFs = 0;
+	mNumUpdatedJoints = 0;
+	mQuatPoseActive = false;
 }
 
 cArticulatedFigure::~cArticulatedFigure()
@@ -34,43 +53,110 @@ cArticulatedFigure::~cArticulatedFigure()
 
 void cArticulatedFigure::Init()
 {
-	// build articulated figure
+	// builds the default biped, other rigs can be loaded with Load
+	bool succ = Load(gDefaultSkeletonFile);
+	if (!succ)
+	{
+		assert(false); // failed to load default skeleton
+	}
+}
+
+bool cArticulatedFigure::Load(const std::string& file)
+{
 	// the character is specified by a kinematic tree
 	// each joint specifies:
-	//		- the parent
+	//		- a name, used by the other joints to refer to it
+	//		- the name of the parent, empty for the root
 	//		- the attachment point of the joint wrt the parent
 	//		- attachment of the link wrt the joint (for rendering)
 	//		- size of the link (for rendering)
 	//		- color of the link (for rendering)
-	// joints should always ordered such that the parent comes before the child
-	mJoints.clear();
-	// root
-	mJoints.push_back(tJointDef(gInvalidJoint, tVector::Zero(), tVector(0, 0.03, 0, 0),
-					tVector(0.12, 0.15, 0.27, 0), tVector(0.4706, 0.549, 0.6863, 1)));
-	// waist
-	mJoints.push_back(tJointDef(0, tVector(0, 0.1, 0, 0), tVector(0, 0.17, 0, 0),
-					tVector(0.13, 0.33, 0.29, 0), tVector(0.4706, 0.549, 0.6863, 1)));
-	// right hip
-	mJoints.push_back(tJointDef(0, tVector(0, 0, 0.085, 0), tVector(0, -0.21075, 0, 0),
-					tVector(0.09, 0.4215, 0.09, 0), tVector(0.6392, 0.6941, 0.7372, 1)));
-	// right knee
-	mJoints.push_back(tJointDef(2, tVector(0, -0.4215, 0, 0), tVector(0, -0.19493, 0, 0),
-					tVector(0.07, 0.43, 0.07, 0), tVector(0.6392, 0.6941, 0.7372, 1)));
-	// right ankle
-	mJoints.push_back(tJointDef(3, tVector(0, -0.40987, 0, 0), tVector(0.0518, -0.0224, 0, 0),
-					tVector(0.177, 0.05, 0.09, 0), tVector(0.6392, 0.6941, 0.7372, 1)));
-	// left hip
-	mJoints.push_back(tJointDef(0, tVector(0, 0, -0.085, 0), tVector(0, -0.21075, 0, 0),
-					tVector(0.09, 0.4215, 0.09, 0), tVector(0.3529, 0.41176, 0.47059, 1)));
-	// left knee
-	mJoints.push_back(tJointDef(5, tVector(0, -0.4215, 0, 0), tVector(0, -0.19493, 0, 0),
-					tVector(0.07, 0.43, 0.07, 0), tVector(0.3529, 0.41176, 0.47059, 1)));
-	// left ankle
-	mJoints.push_back(tJointDef(6, tVector(0, -0.40987, 0, 0), tVector(0.0518, -0.0224, 0, 0),
-					tVector(0.177, 0.05, 0.09, 0), tVector(0.3529, 0.41176, 0.47059, 1)));
-
-
-	mPose = Eigen::VectorXd::Zero(GetNumDOFs());
+	// the parameters of the joints in a pose follow the order of the joints in the file,
+	// the joints themselves are sorted such that the parent comes before the child
+	std::ifstream f_stream(file.c_str());
+	Json::Reader reader;
+	Json::Value root;
+	bool succ = f_stream.good() && reader.parse(f_stream, root) && root.isObject();
+	f_stream.close();
+
+	tJointDefArr joints;
+	std::vector<std::string> parent_names;
+	if (succ)
+	{
+		const Json::Value& joints_json = root[gJointsKey];
+		succ = joints_json.isArray() && joints_json.size() > 0;
+		if (succ)
+		{
+			int num_joints = joints_json.size();
+			joints.resize(num_joints);
+			parent_names.resize(num_joints);
+			for (int j = 0; j < num_joints && succ; ++j)
+			{
+				succ = ParseJoint(joints_json[j], joints[j], parent_names[j]);
+				if (!succ)
+				{
+					printf("Invalid joint %i\n", j);
+				}
+			}
+		}
+	}
+
+	if (succ)
+	{
+		succ = ResolveParents(parent_names, joints);
+	}
+
+	std::vector<int> order;
+	if (succ)
+	{
+		succ = SortJoints(joints, order);
+	}
+
+	if (succ)
+	{
+		int num_joints = static_cast<int>(joints.size());
+		std::vector<int> file_param_offsets(num_joints);
+		int param_offset = 0;
+		for (int j = 0; j < num_joints; ++j)
+		{
+			file_param_offsets[j] = param_offset;
+			param_offset += (joints[j].mParentJoint == gInvalidJoint) ? gRootDOF : gJointDOF;
+		}
+
+		std::vector<int> new_ids(num_joints);
+		for (int j = 0; j < num_joints; ++j)
+		{
+			new_ids[order[j]] = j;
+		}
+
+		if (order != new_ids)
+		{
+			printf("Reordered joints in %s so that parents come before their children\n", file.c_str());
+		}
+
+		mJoints.resize(num_joints);
+		std::vector<int> param_offsets(num_joints);
+		for (int j = 0; j < num_joints; ++j)
+		{
+			tJointDef& curr_joint = mJoints[j];
+			curr_joint = joints[order[j]];
+			if (curr_joint.mParentJoint != gInvalidJoint)
+			{
+				curr_joint.mParentJoint = new_ids[curr_joint.mParentJoint];
+			}
+			param_offsets[j] = file_param_offsets[order[j]];
+		}
+
+		BuildTables(param_offsets);
+		mPose = Eigen::VectorXd::Zero(GetNumDOFs());
+		UpdateJointWorldTrans();
+	}
+	else
+	{
+		printf("Failed to load skeleton from %s\n", file.c_str());
+	}
+
+	return succ;
 }
 
 void cArticulatedFigure::SetPose(const Eigen::VectorXd& pose)
@@ -82,12 +168,101 @@ void cArticulatedFigure::SetPose(const Eigen::VectorXd& pose)
 	// rotations are in Euler angles specified with order XYZ
 	// the rotation transform is computed as rot(Z) * rot(Y) * rot(X)
 	assert(pose.size() == GetNumDOFs());
+	if (mQuatPoseActive)
+	{
+		// the cached transforms came from a quaternion pose
+		MarkAllJointsDirty();
+		mQuatPoseActive = false;
+	}
+
+	// only joints with new parameters are marked for an update
+	int num_joints = GetNumJoints();
+	for (int j = 0; j < num_joints; ++j)
+	{
+		if (!mJointParamsDirty[j])
+		{
+			int param_offset = mParamOffsets[j];
+			int param_size = GetJointParamSize(j);
+			mJointParamsDirty[j] = pose.segment(param_offset, param_size) != mPose.segment(param_offset, param_size);
+		}
+	}
+
 	mPose = pose;
+	UpdateJointWorldTrans();
+}
+
+void cArticulatedFigure::SetPose(const tQuatPose& pose)
+{
+	// the rotations are used directly, joints are only recomputed if their rotation
+	// or the root position changed since the last quaternion pose
+	int num_joints = GetNumJoints();
+	assert(static_cast<int>(pose.mJointRots.size()) == num_joints);
+
+	bool force_update = !mQuatPoseActive;
+	mQuatPose.mJointRots.resize(num_joints);
+	for (int j = 0; j < num_joints; ++j)
+	{
+		bool changed = force_update || pose.mJointRots[j].coeffs() != mQuatPose.mJointRots[j].coeffs();
+		if (mParentIDs[j] == gInvalidJoint)
+		{
+			changed |= pose.mRootPos != mQuatPose.mRootPos;
+		}
+
+		if (changed)
+		{
+			mJointPoseTrans[j] = CalcJointPoseTrans(pose, j);
+			mJointPoseDirty[j] = true;
+		}
+	}
+
+	mQuatPose.mRootPos = pose.mRootPos;
+	mQuatPose.mJointRots = pose.mJointRots;
+	mQuatPoseActive = true;
+	UpdateJointWorldTrans();
+}
+
+void cArticulatedFigure::SetJointParams(int joint_id, const Eigen::VectorXd& params)
+{
+	// updates the parameters of a single joint, e.g. for edits that only move one limb
+	assert(params.size() == GetJointParamSize(joint_id));
+	if (mQuatPoseActive)
+	{
+		MarkAllJointsDirty();
+		mQuatPoseActive = false;
+	}
+	mPose.segment(mParamOffsets[joint_id], params.size()) = params;
+	mJointParamsDirty[joint_id] = true;
+	UpdateJointWorldTrans();
+}
+
+const Eigen::VectorXd& cArticulatedFigure::GetPose() const
+{
+	return mPose;
+}
+
+void cArticulatedFigure::BuildQuatPose(const Eigen::VectorXd& pose, tQuatPose& out_pose) const
+{
+	// converts the Euler angles of every joint to quaternions
+	assert(pose.size() == GetNumDOFs());
+	int num_joints = GetNumJoints();
+	out_pose.mJointRots.resize(num_joints);
+	for (int j = 0; j < num_joints; ++j)
+	{
+		int param_offset = mParamOffsets[j];
+		if (mParentIDs[j] == gInvalidJoint)
+		{
+			out_pose.mRootPos = tVector(pose[param_offset], pose[param_offset + 1], pose[param_offset + 2], 0);
+			param_offset += 3;
+		}
+
+		tVector euler = tVector(pose[param_offset], pose[param_offset + 1], pose[param_offset + 2], 0);
+		out_pose.mJointRots[j] = cMathUtil::EulerToQuaternion(euler);
+	}
 }
 
 int cArticulatedFigure::GetNumDOFs() const
 {
-	return (GetNumJoints() - 1) * gJointDOF + gRootDOF;
+	return mNumDOFs;
 }
 
 int cArticulatedFigure::GetNumJoints() const
@@ -95,78 +270,468 @@ int cArticulatedFigure::GetNumJoints() const
 	return static_cast<int>(mJoints.size());
 }
 
-void cArticulatedFigure::Draw()
+const cArticulatedFigure::tJointDef& cArticulatedFigure::GetJointDef(int joint_id) const
+{
+	return mJoints[joint_id];
+}
+
+const tMatrix& cArticulatedFigure::GetJointWorldTrans(int joint_id) const
+{
+	return mJointWorldTrans[joint_id];
+}
+
+const tMatrix* cArticulatedFigure::GetJointWorldTransforms() const
+{
+	return mJointWorldTrans.data();
+}
+
+tVector cArticulatedFigure::CalcJointWorldPos(int joint_id) const
+{
+	const tMatrix& trans = mJointWorldTrans[joint_id];
+	return tVector(trans(0, 3), trans(1, 3), trans(2, 3), 0);
+}
+
+int cArticulatedFigure::GetNumUpdatedJoints() const
+{
+	return mNumUpdatedJoints;
+}
+
+tMatrix cArticulatedFigure::CalcLinkWorldTrans(int joint_id) const
+{
+	// transform of the link attached to a joint, including the scaling by the link size
+	const tJointDef& joint = mJoints[joint_id];
+	return mJointWorldTrans[joint_id] * cMathUtil::TranslateMat(joint.mLinkAttachPt)
+			* cMathUtil::ScaleMat(joint.mLinkSize);
+}
+
+int cArticulatedFigure::FindJoint(const std::string& name) const
 {
-	std::stack<int> joint_stack;
+	for (int j = 0; j < GetNumJoints(); ++j)
+	{
+		if (mJoints[j].mName == name)
+		{
+			return j;
+		}
+	}
+	return gInvalidJoint;
+}
 
+void cArticulatedFigure::ComputeFK(const Eigen::VectorXd& pose, tMatrix* out_trans) const
+{
+	// joints are ordered such that the parent comes before the child,
+	// so the transforms can be built in a single pass over the joint tables
+	assert(pose.size() == GetNumDOFs());
 	int num_joints = GetNumJoints();
 	for (int j = 0; j < num_joints; ++j)
 	{
-		const tJointDef& curr_joint = mJoints[j];
-		bool is_root = (j == 0);
-		int parent_id = curr_joint.mParentJoint;
+		int parent_id = mParentIDs[j];
+		if (parent_id == gInvalidJoint)
+		{
+			out_trans[j] = CalcJointPoseTrans(pose, j);
+		}
+		else
+		{
+			out_trans[j] = out_trans[parent_id] * CalcJointPoseTrans(pose, j);
+		}
+	}
+}
 
-		while (!joint_stack.empty() && joint_stack.top() != parent_id)
+void cArticulatedFigure::ComputeFK(const tQuatPose& pose, tMatrix* out_trans) const
+{
+	int num_joints = GetNumJoints();
+	assert(static_cast<int>(pose.mJointRots.size()) == num_joints);
+	for (int j = 0; j < num_joints; ++j)
+	{
+		int parent_id = mParentIDs[j];
+		if (parent_id == gInvalidJoint)
 		{
-			joint_stack.pop();
-			cDrawUtil::PopMatrix();
+			out_trans[j] = CalcJointPoseTrans(pose, j);
 		}
+		else
+		{
+			out_trans[j] = out_trans[parent_id] * CalcJointPoseTrans(pose, j);
+		}
+	}
+}
 
-		joint_stack.push(j);
-		if (is_root)
+void cArticulatedFigure::ComputeFKBatch(const Eigen::MatrixXd& poses, int col_beg, int num_chars,
+										tFKBatchBuffer& buffer, tMatrix* out_trans) const
+{
+	// characters are processed in batches of gFKBatchSize, the same joint across a batch is
+	// computed with packet math and then scattered back into the per character transforms
+	assert(poses.rows() == GetNumDOFs());
+	assert(col_beg >= 0 && col_beg + num_chars <= poses.cols());
+
+	int num_joints = GetNumJoints();
+	buffer.resize(num_joints);
+
+	for (int beg = 0; beg < num_chars; beg += gFKBatchSize)
+	{
+		int num_lanes = std::min(num_chars - beg, static_cast<int>(gFKBatchSize));
+		ComputeFKLanes(poses, col_beg + beg, num_lanes, buffer.data());
+
+		for (int lane = 0; lane < num_lanes; ++lane)
 		{
-			int param_offset = GetJointParamOffset(j);
+			tMatrix* char_trans = out_trans + (beg + lane) * num_joints;
+			for (int j = 0; j < num_joints; ++j)
+			{
+				const tFKBatchTrans& joint_trans = buffer[j];
+				tMatrix& curr_trans = char_trans[j];
+				for (int r = 0; r < 3; ++r)
+				{
+					curr_trans(r, 0) = joint_trans.mRot[r][0][lane];
+					curr_trans(r, 1) = joint_trans.mRot[r][1][lane];
+					curr_trans(r, 2) = joint_trans.mRot[r][2][lane];
+					curr_trans(r, 3) = joint_trans.mPos[r][lane];
+				}
+				curr_trans.row(3) = tVector(0, 0, 0, 1);
+			}
+		}
+	}
+}
+
+void cArticulatedFigure::Draw()
+{
+	// the links are drawn from the joint transforms computed by the last SetPose
+	int num_joints = GetNumJoints();
+	for (int j = 0; j < num_joints; ++j)
+	{
+		const tJointDef& curr_joint = mJoints[j];
+
+		cDrawUtil::PushMatrix();
+		cDrawUtil::MultMatrix(mJointWorldTrans[j]);
+		cDrawUtil::SetColor(curr_joint.mCol);
+		cDrawUtil::DrawBox(curr_joint.mLinkAttachPt, curr_joint.mLinkSize);
+		cDrawUtil::PopMatrix();
+	}
+}
+
+bool cArticulatedFigure::ParseJoint(const Json::Value& json, tJointDef& out_joint, std::string& out_parent) const
+{
+	// values are type checked before they are converted, since jsoncpp throws on mismatched types
+	bool succ = json.isObject() && json[gNameKey].isString();
+	if (succ)
+	{
+		// the parent can be omitted for the root, but otherwise it has to be a name
+		const Json::Value& parent_json = json[gParentKey];
+		succ = parent_json.isNull() || parent_json.isString();
+	}
 
-			tVector trans = tVector(mPose[param_offset], mPose[param_offset + 1], mPose[param_offset + 2], 0);
-			tVector euler = tVector(mPose[param_offset + 3], mPose[param_offset + 4], mPose[param_offset + 5], 0);
-			
-			cDrawUtil::PushMatrix();
-			cDrawUtil::Translate(trans);
-			cDrawUtil::Rotate(euler);
-			cDrawUtil::Translate(curr_joint.mAttachPt);
+	if (succ)
+	{
+		out_joint = tJointDef();
+		out_joint.mName = json[gNameKey].asString();
+		out_parent = (json[gParentKey].isString()) ? json[gParentKey].asString() : "";
 
-			cDrawUtil::SetColor(curr_joint.mCol);
-			cDrawUtil::PushMatrix();
-			cDrawUtil::DrawBox(curr_joint.mLinkAttachPt, curr_joint.mLinkSize);
-			cDrawUtil::PopMatrix();
+		succ &= ParseVector(json[gAttachPtKey], 3, out_joint.mAttachPt);
+		succ &= ParseVector(json[gLinkAttachPtKey], 3, out_joint.mLinkAttachPt);
+		succ &= ParseVector(json[gLinkSizeKey], 3, out_joint.mLinkSize);
+		if (!json[gColorKey].isNull())
+		{
+			succ &= ParseVector(json[gColorKey], 3, out_joint.mCol);
 		}
-		else
+	}
+	return succ;
+}
+
+bool cArticulatedFigure::ResolveParents(const std::vector<std::string>& parent_names, tJointDefArr& out_joints) const
+{
+	// every joint needs a unique name, and exactly one joint can be without a parent
+	bool succ = true;
+	int num_joints = static_cast<int>(out_joints.size());
+	int num_roots = 0;
+	for (int j = 0; j < num_joints && succ; ++j)
+	{
+		tJointDef& curr_joint = out_joints[j];
+		curr_joint.mParentJoint = gInvalidJoint;
+
+		for (int i = 0; i < num_joints; ++i)
+		{
+			const std::string& curr_name = out_joints[i].mName;
+			if (i != j && curr_name == curr_joint.mName)
+			{
+				printf("Duplicate joint name %s\n", curr_name.c_str());
+				succ = false;
+			}
+			if (curr_name == parent_names[j])
+			{
+				curr_joint.mParentJoint = i;
+			}
+		}
+
+		if (parent_names[j] == "")
+		{
+			++num_roots;
+		}
+		else if (curr_joint.mParentJoint == gInvalidJoint || curr_joint.mParentJoint == j)
 		{
-			int param_offset = GetJointParamOffset(j);
+			printf("Invalid parent %s for joint %s\n", parent_names[j].c_str(), curr_joint.mName.c_str());
+			succ = false;
+		}
+	}
+
+	if (succ && num_roots != 1)
+	{
+		printf("Skeleton has %i roots, only a single root is supported\n", num_roots);
+		succ = false;
+	}
+	return succ;
+}
+
+bool cArticulatedFigure::SortJoints(const tJointDefArr& joints, std::vector<int>& out_order) const
+{
+	// depth first topological sort that places every parent before its children,
+	// joints that are already in a valid order keep their order
+	enum eVisit
+	{
+		eVisitNone,
+		eVisitActive,
+		eVisitDone
+	};
+
+	int num_joints = static_cast<int>(joints.size());
+	std::vector<eVisit> visits(num_joints, eVisitNone);
+	std::vector<int> path;
+	out_order.clear();
 
-			tVector euler = tVector(mPose[param_offset], mPose[param_offset + 1], mPose[param_offset + 2], 0);
+	for (int j = 0; j < num_joints; ++j)
+	{
+		// walk up the hierarchy until a joint that is already placed, then place the path top down
+		path.clear();
+		int curr_id = j;
+		while (curr_id != gInvalidJoint && visits[curr_id] == eVisitNone)
+		{
+			visits[curr_id] = eVisitActive;
+			path.push_back(curr_id);
+			curr_id = joints[curr_id].mParentJoint;
+		}
 
-			cDrawUtil::PushMatrix();
-			cDrawUtil::Translate(curr_joint.mAttachPt);
-			cDrawUtil::Rotate(euler);
+		if (curr_id != gInvalidJoint && visits[curr_id] == eVisitActive)
+		{
+			printf("Cycle in skeleton at joint %s\n", joints[curr_id].mName.c_str());
+			return false;
+		}
 
-			cDrawUtil::SetColor(curr_joint.mCol);
-			cDrawUtil::PushMatrix();
-			cDrawUtil::DrawBox(curr_joint.mLinkAttachPt, curr_joint.mLinkSize);
-			cDrawUtil::PopMatrix();
+		for (int i = static_cast<int>(path.size()) - 1; i >= 0; --i)
+		{
+			visits[path[i]] = eVisitDone;
+			out_order.push_back(path[i]);
 		}
 	}
+	return true;
+}
 
-	while (!joint_stack.empty())
+bool cArticulatedFigure::ParseVector(const Json::Value& json, int min_size, tVector& out_vec)
+{
+	// reads up to 4 numbers into out_vec, the remaining entries keep their values
+	bool succ = json.isArray() && static_cast<int>(json.size()) >= min_size && json.size() <= 4;
+	if (succ)
 	{
-		joint_stack.pop();
-		cDrawUtil::PopMatrix();
+		for (int i = 0; i < static_cast<int>(json.size()) && succ; ++i)
+		{
+			succ = json[i].isNumeric();
+			if (succ)
+			{
+				out_vec[i] = json[i].asDouble();
+			}
+		}
 	}
+	return succ;
 }
 
-int cArticulatedFigure::GetJointParamOffset(int joint_id) const
+void cArticulatedFigure::BuildTables(const std::vector<int>& param_offsets)
+{
+	int num_joints = GetNumJoints();
+	mParamOffsets = param_offsets;
+	mParentIDs.resize(num_joints);
+	mLocalTrans.resize(num_joints);
+
+	mJointPoseTrans.resize(num_joints);
+	mJointWorldTrans.resize(num_joints);
+	mJointParamsDirty.assign(num_joints, true);
+	mJointPoseDirty.assign(num_joints, false);
+	mQuatPoseActive = false;
+	mJointUpdated.assign(num_joints, false);
+
+	mNumDOFs = 0;
+	for (int j = 0; j < num_joints; ++j)
+	{
+		const tJointDef& curr_joint = mJoints[j];
+		mParentIDs[j] = curr_joint.mParentJoint;
+		mLocalTrans[j] = cMathUtil::TranslateMat(curr_joint.mAttachPt);
+		mNumDOFs += GetJointParamSize(j);
+	}
+}
+
+tMatrix cArticulatedFigure::CalcJointPoseTrans(const Eigen::VectorXd& pose, int joint_id) const
+{
+	// the root is T(trans) * R(euler) * T(attach), the other joints are T(attach) * R(euler)
+	int param_offset = mParamOffsets[joint_id];
+	bool is_root = mParentIDs[joint_id] == gInvalidJoint;
+
+	tMatrix trans;
+	if (is_root)
+	{
+		tVector pos = tVector(pose[param_offset], pose[param_offset + 1], pose[param_offset + 2], 0);
+		tVector euler = tVector(pose[param_offset + 3], pose[param_offset + 4], pose[param_offset + 5], 0);
+		trans = cMathUtil::TranslateMat(pos) * cMathUtil::RotateMat(euler) * mLocalTrans[joint_id];
+	}
+	else
+	{
+		tVector euler = tVector(pose[param_offset], pose[param_offset + 1], pose[param_offset + 2], 0);
+		trans = mLocalTrans[joint_id] * cMathUtil::RotateMat(euler);
+	}
+	return trans;
+}
+
+tMatrix cArticulatedFigure::CalcJointPoseTrans(const tQuatPose& pose, int joint_id) const
 {
-	bool is_root = joint_id == 0;
+	tMatrix trans;
+	const tQuaternion& rot = pose.mJointRots[joint_id];
+	bool is_root = mParentIDs[joint_id] == gInvalidJoint;
 	if (is_root)
 	{
-		return 0;
+		trans = cMathUtil::TranslateMat(pose.mRootPos) * cMathUtil::RotateMat(rot) * mLocalTrans[joint_id];
+	}
+	else
+	{
+		trans = mLocalTrans[joint_id] * cMathUtil::RotateMat(rot);
+	}
+	return trans;
+}
+
+void cArticulatedFigure::MarkAllJointsDirty()
+{
+	mJointParamsDirty.assign(GetNumJoints(), true);
+}
+
+void cArticulatedFigure::UpdateJointWorldTrans()
+{
+	// a joint is recomputed if its own parameters changed or if its parent was recomputed,
+	// since parents come before their children this propagates down every subtree in one pass
+	mNumUpdatedJoints = 0;
+	int num_joints = GetNumJoints();
+	for (int j = 0; j < num_joints; ++j)
+	{
+		int parent_id = mParentIDs[j];
+		if (mJointParamsDirty[j])
+		{
+			mJointPoseTrans[j] = CalcJointPoseTrans(mPose, j);
+			mJointParamsDirty[j] = false;
+			mJointPoseDirty[j] = true;
+		}
+
+		bool update = mJointPoseDirty[j];
+		mJointPoseDirty[j] = false;
+
+		if (parent_id == gInvalidJoint)
+		{
+			if (update)
+			{
+				mJointWorldTrans[j] = mJointPoseTrans[j];
+			}
+		}
+		else
+		{
+			update |= mJointUpdated[parent_id];
+			if (update)
+			{
+				mJointWorldTrans[j] = mJointWorldTrans[parent_id] * mJointPoseTrans[j];
+			}
+		}
+
+		mJointUpdated[j] = update;
+		mNumUpdatedJoints += (update) ? 1 : 0;
+	}
+}
+
+void cArticulatedFigure::ComputeFKLanes(const Eigen::MatrixXd& poses, int col_beg, int num_lanes, tFKBatchTrans* out_trans) const
+{
+	// unused lanes of a partial batch repeat the last character
+	int num_joints = GetNumJoints();
+	for (int j = 0; j < num_joints; ++j)
+	{
+		int param_offset = mParamOffsets[j];
+		int param_size = GetJointParamSize(j);
+		int parent_id = mParentIDs[j];
+		bool is_root = (parent_id == gInvalidJoint);
+
+		tFKLanes params[gRootDOF];
+		for (int lane = 0; lane < gFKBatchSize; ++lane)
+		{
+			int col = col_beg + std::min(lane, num_lanes - 1);
+			for (int p = 0; p < param_size; ++p)
+			{
+				params[p][lane] = poses(param_offset + p, col);
+			}
+		}
+
+		tFKBatchTrans& curr_trans = out_trans[j];
+		const tVector& attach = mJoints[j].mAttachPt;
+		if (is_root)
+		{
+			// T(trans) * R(euler) * T(attach)
+			EulerToRotLanes(params[3], params[4], params[5], curr_trans.mRot);
+			for (int r = 0; r < 3; ++r)
+			{
+				curr_trans.mPos[r] = params[r] + curr_trans.mRot[r][0] * attach[0]
+									+ curr_trans.mRot[r][1] * attach[1] + curr_trans.mRot[r][2] * attach[2];
+			}
+		}
+		else
+		{
+			// parent * T(attach) * R(euler)
+			const tFKBatchTrans& parent_trans = out_trans[parent_id];
+			tFKLanes rot[3][3];
+			EulerToRotLanes(params[0], params[1], params[2], rot);
+
+			for (int r = 0; r < 3; ++r)
+			{
+				const tFKLanes* parent_row = parent_trans.mRot[r];
+				for (int c = 0; c < 3; ++c)
+				{
+					curr_trans.mRot[r][c] = parent_row[0] * rot[0][c] + parent_row[1] * rot[1][c] + parent_row[2] * rot[2][c];
+				}
+				curr_trans.mPos[r] = parent_trans.mPos[r] + parent_row[0] * attach[0]
+									+ parent_row[1] * attach[1] + parent_row[2] * attach[2];
+			}
+		}
 	}
-	return gRootDOF + (joint_id - 1) * gJointDOF;
+}
+
+void cArticulatedFigure::EulerToRotLanes(const tFKLanes& x, const tFKLanes& y, const tFKLanes& z, tFKLanes out_rot[3][3])
+{
+	// same as cMathUtil::RotateMat(euler), rot(Z) * rot(Y) * rot(X)
+	// Eigen 3.2 only has packet sin and cos for floats, so the trig is still evaluated one lane at a time,
+	// only the products that build the matrix are vectorized
+	tFKLanes x_s = x.sin();
+	tFKLanes x_c = x.cos();
+	tFKLanes y_s = y.sin();
+	tFKLanes y_c = y.cos();
+	tFKLanes z_s = z.sin();
+	tFKLanes z_c = z.cos();
+
+	out_rot[0][0] = y_c * z_c;
+	out_rot[1][0] = y_c * z_s;
+	out_rot[2][0] = -y_s;
+
+	out_rot[0][1] = x_s * y_s * z_c - x_c * z_s;
+	out_rot[1][1] = x_s * y_s * z_s + x_c * z_c;
+	out_rot[2][1] = x_s * y_c;
+
+	out_rot[0][2] = x_c * y_s * z_c + x_s * z_s;
+	out_rot[1][2] = x_c * y_s * z_s - x_s * z_c;
+	out_rot[2][2] = x_c * y_c;
+}
+
+int cArticulatedFigure::GetJointParamOffset(int joint_id) const
+{
+	return mParamOffsets[joint_id];
 }
 
 int cArticulatedFigure::GetJointParamSize(int joint_id) const
 {
-	bool is_root = joint_id == 0;
+	bool is_root = mJoints[joint_id].mParentJoint == gInvalidJoint;
 	if (is_root)
 	{
 		return gRootDOF;
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <string>
 #include "Eigen/Dense"
 #include "Eigen/StdVector"
 #include <json/json.h>
@@ -10,9 +11,13 @@ class cArticulatedFigure
 public:
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+	// number of characters processed together by ComputeFKBatch
+	static const int gFKBatchSize = 4;
+
 	struct tJointDef
 	{
 		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		std::string mName;
 		int mParentJoint;
 		tVector mAttachPt;
 		tVector mLinkAttachPt;
@@ -24,21 +29,111 @@ public:
 					const tVector& link_size, const tVector& col);
 	};
 
+	// pose with the rotation of every joint stored as a unit quaternion instead of Euler angles,
+	// so that FK does not have to evaluate any trigonometric functions
+	struct tQuatPose
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		tVector mRootPos;
+		std::vector<tQuaternion, Eigen::aligned_allocator<tQuaternion>> mJointRots; // indexed by joint id
+
+		tQuatPose();
+	};
+
 	cArticulatedFigure();
 	virtual ~cArticulatedFigure();
 
 	virtual void Init();
+	virtual bool Load(const std::string& file);
 	virtual void SetPose(const Eigen::VectorXd& pose);
+	virtual void SetPose(const tQuatPose& pose);
+	virtual void SetJointParams(int joint_id, const Eigen::VectorXd& params);
+	// last pose set in Euler angles, it is not updated by quaternion poses
+	virtual const Eigen::VectorXd& GetPose() const;
+	virtual void BuildQuatPose(const Eigen::VectorXd& pose, tQuatPose& out_pose) const;
 	virtual int GetNumDOFs() const;
 	virtual int GetNumJoints() const;
+	virtual const tJointDef& GetJointDef(int joint_id) const;
+	virtual int FindJoint(const std::string& name) const;
+
+	// location of the parameters of a joint in the pose vector
+	virtual int GetJointParamOffset(int joint_id) const;
+	virtual int GetJointParamSize(int joint_id) const;
+
+	// world transforms of the joints for the current pose, updated by SetPose
+	virtual const tMatrix& GetJointWorldTrans(int joint_id) const;
+	virtual const tMatrix* GetJointWorldTransforms() const;
+	virtual tVector CalcJointWorldPos(int joint_id) const;
+	virtual tMatrix CalcLinkWorldTrans(int joint_id) const;
+	// number of joints whose world transforms were recomputed by the last pose update
+	virtual int GetNumUpdatedJoints() const;
+
+	// computes the world transform of every joint for a given pose,
+	// out_trans should have room for one transform per joint
+	virtual void ComputeFK(const Eigen::VectorXd& pose, tMatrix* out_trans) const;
+	virtual void ComputeFK(const tQuatPose& pose, tMatrix* out_trans) const;
+
+	// transforms of one joint across a batch of characters, stored as SoA,
+	// so that each matrix entry holds the values of every character in the batch
+	typedef Eigen::Array<double, gFKBatchSize, 1> tFKLanes;
+	struct tFKBatchTrans
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		tFKLanes mRot[3][3];
+		tFKLanes mPos[3];
+	};
+	// scratch storage for ComputeFKBatch, it only allocates the first time it is used with a skeleton,
+	// a buffer should not be shared by calls running on different threads
+	typedef std::vector<tFKBatchTrans, Eigen::aligned_allocator<tFKBatchTrans>> tFKBatchBuffer;
+
+	// computes the world transforms for num_chars poses stored in consecutive columns of poses,
+	// starting at column col_beg, the transforms of the i'th character are written to out_trans[i * num joints]
+	virtual void ComputeFKBatch(const Eigen::MatrixXd& poses, int col_beg, int num_chars,
+								tFKBatchBuffer& buffer, tMatrix* out_trans) const;
 
 	virtual void Draw();
 
 protected:
 	
+	typedef std::vector<tJointDef, Eigen::aligned_allocator<tJointDef>> tJointDefArr;
+
 	Eigen::VectorXd mPose;
-	std::vector<tJointDef, Eigen::aligned_allocator<tJointDef>> mJoints;
+	tJointDefArr mJoints;
 
-	virtual int GetJointParamOffset(int joint_id) const;
-	virtual int GetJointParamSize(int joint_id) const;
+	// tables derived from mJoints when the skeleton is loaded, so that FK is a single sweep over flat arrays
+	int mNumDOFs;
+	std::vector<int> mParentIDs;
+	std::vector<int> mParamOffsets;
+	// transform of each joint wrt its parent that does not depend on the pose
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mLocalTrans;
+
+	// transform of each joint wrt its parent for mPose, and the resulting world transform,
+	// stored in the same order as mJoints
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mJointPoseTrans;
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mJointWorldTrans;
+
+	// joints whose parameters changed since the last update, only these joints
+	// and their descendants are recomputed
+	std::vector<bool> mJointParamsDirty;
+	std::vector<bool> mJointPoseDirty;
+	std::vector<bool> mJointUpdated;
+	int mNumUpdatedJoints;
+
+	// last quaternion pose, used while the figure is posed with quaternions
+	tQuatPose mQuatPose;
+	bool mQuatPoseActive;
+
+	virtual bool ParseJoint(const Json::Value& json, tJointDef& out_joint, std::string& out_parent) const;
+	virtual bool ResolveParents(const std::vector<std::string>& parent_names, tJointDefArr& out_joints) const;
+	virtual bool SortJoints(const tJointDefArr& joints, std::vector<int>& out_order) const;
+	virtual void BuildTables(const std::vector<int>& param_offsets);
+
+	virtual tMatrix CalcJointPoseTrans(const Eigen::VectorXd& pose, int joint_id) const;
+	virtual tMatrix CalcJointPoseTrans(const tQuatPose& pose, int joint_id) const;
+	virtual void MarkAllJointsDirty();
+	virtual void UpdateJointWorldTrans();
+	virtual void ComputeFKLanes(const Eigen::MatrixXd& poses, int col_beg, int num_lanes, tFKBatchTrans* out_trans) const;
+
+	static bool ParseVector(const Json::Value& json, int min_size, tVector& out_vec);
+	static void EulerToRotLanes(const tFKLanes& x, const tFKLanes& y, const tFKLanes& z, tFKLanes out_rot[3][3]);
 };
\ No newline at end of file
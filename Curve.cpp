@@ -1,11 +1,57 @@
 #include "Curve.h"
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "util/MathUtil.h"
 
 const std::string gTypeKey = "Type";
 const std::string gAnchorsKey = "Anchors";
 const std::string gAnchorPosKey = "Pos";
 const std::string gSegmentDurationKey = "SegmentDuration";
+const std::string gSegmentDurationsKey = "SegmentDurations";
+
+// binary curve files start with a header, followed by the segment durations (if any)
+// and the anchor positions, stored as a dense column-major dim x num anchors matrix of
+// little-endian doubles, the anchor matrix is aligned so that it can be used in place
+const char gCurveFileMagic[4] = { 'C', 'R', 'V', 'B' };
+const uint32_t gCurveFileVersion = 1;
+const uint32_t gCurveFileEndianTag = 0x01020304;
+const size_t gCurveFileAlignment = 16;
+
+struct tCurveFileHeader
+{
+	char mMagic[4];
+	uint32_t mVersion;
+	uint32_t mEndianTag;
+	int32_t mCurveType;
+	int32_t mDim;
+	int32_t mNumAnchors;
+	int32_t mNumSegDurations; // 0 if every segment uses the default duration
+	int32_t mPadding;
+	double mSegmentDuration;
+	uint64_t mAnchorOffset; // byte offset of the anchor matrix from the start of the file
+};
+
+// number of polynomial coefficients per dimension for each cubic segment
+const int gNumSegCoeffs = 4;
+
+// number of arc length table entries per segment
+const int gArcLengthSteps = 8;
+const int gArcLengthNewtonIters = 3;
+
+// max number of segments stepped over when searching from a hint before falling back to a binary search
+const int gSegSearchSteps = 4;
+
+// limits on the number of times a segment is split in half during tessellation
+const int gTessMinDepth = 1;
+const int gTessMaxDepth = 12;
+
+// 5 point gauss-legendre quadrature on [-1, 1]
+const int gNumQuadPts = 5;
+const double gQuadPts[gNumQuadPts] = { 0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640, 0.9061798459386640 };
+const double gQuadWeights[gNumQuadPts] = { 0.5688888888888889, 0.4786286704993665, 0.4786286704993665, 0.2369268850561891, 0.2369268850561891 };
 
 
 cCurve::tAnchor::tAnchor()
@@ -40,10 +86,44 @@ cCurve::eCurveType cCurve::ParseCurveType(const std::string& str)
 	return curve_type;
 }
 
+const tCurveSegKernels& cCurve::GetSegKernels(eCurveType curve_type, int dim)
+{
+	// picks the kernels specialized for 3D paths, all other dimensions use the dynamically sized kernels,
+	// a fixed size of 27 for the biped poses is not vectorized by Eigen and is slower (see CurveKernels in the bench)
+	switch (curve_type)
+	{
+	case eCurveTypeCatmullRom:
+		switch (dim)
+		{
+		case 3:
+			return cCurveKernels<3, tCatmullRomBasis>::gSegKernels;
+		default:
+			return cCurveKernels<Eigen::Dynamic, tCatmullRomBasis>::gSegKernels;
+		}
+	case eCurveTypeBSpline:
+		switch (dim)
+		{
+		case 3:
+			return cCurveKernels<3, tBSplineBasis>::gSegKernels;
+		default:
+			return cCurveKernels<Eigen::Dynamic, tBSplineBasis>::gSegKernels;
+		}
+	default:
+		assert(false); // unsupported curve type
+		break;
+	}
+	return cCurveKernels<Eigen::Dynamic, tCatmullRomBasis>::gSegKernels;
+}
+
 cCurve::cCurve()
 {
 	mSegmentDuration = 1;
+	mUniformSegs = true;
 	mCurveType = eCurveTypeCatmullRom;
+	mSegKernels = &GetSegKernels(mCurveType, 0);
+	mMappedAnchorPos = nullptr;
+	mMappedDim = 0;
+	mMappedNumAnchors = 0;
 }
 
 cCurve::~cCurve()
@@ -52,64 +132,157 @@ cCurve::~cCurve()
 
 bool cCurve::Load(const std::string& file)
 {
-	// load a set of anchor points and other parameters from a text file
-	// file should be formatted as a JSON
+	// load a set of anchor points and other parameters from a file
+	// the file can either be formatted as a JSON or be a binary curve file
 	bool succ = true;
 	Clear();
 
-	std::ifstream f_stream(file.c_str());
-	Json::Value root;
-	Json::Reader reader;
-	succ = reader.parse(f_stream, root);
-	f_stream.close();
+	if (IsBinaryFile(file))
+	{
+		succ = LoadBinary(file);
+	}
+	else
+	{
+		succ = LoadJson(file);
+	}
 
 	if (succ)
 	{
-		// parse misc parameters from the file
-		std::string type_str = root.get(gTypeKey, "").asString();
-		mCurveType = ParseCurveType(type_str);
-		mSegmentDuration = root.get(gSegmentDurationKey, 1).asDouble();
+		BuildSegCoeffs();
+		BuildArcLengths(0);
 
-		// parse the list of anchors
-		if (!root[gAnchorsKey].isNull())
+		// compute and store the tangents at the achor points
+		// these achnor tangets are currently used only for visualization
+		ComputeAnchorTangents();
+	}
+	else
+	{
+		Clear();
+	}
+
+	return succ;
+}
+
+bool cCurve::SaveBinary(const std::string& file) const
+{
+	// writes the curve to a binary curve file that can be loaded with Load
+	// anchor tangents and other cached data are not stored, they are rebuilt when loading
+	bool succ = true;
+	uint32_t endian_tag = gCurveFileEndianTag;
+	if (reinterpret_cast<const char*>(&endian_tag)[0] != 0x04)
+	{
+		printf("Binary curve files can only be written on little-endian machines\n");
+		return false;
+	}
+
+	int dim = GetDim();
+	int num_anchors = GetNumAnchors();
+	int num_segs = std::max(0, GetNumSegments());
+
+	std::vector<double> durations;
+	if (!mUniformSegs)
+	{
+		durations.resize(num_segs);
+		for (int i = 0; i < num_segs; ++i)
 		{
-			auto anchors_json = root.get(gAnchorsKey, 0);
-			succ &= ParseAnchors(anchors_json);
+			durations[i] = GetSegDuration(i);
 		}
 	}
 
+	size_t durations_size = durations.size() * sizeof(double);
+	size_t anchor_offset = sizeof(tCurveFileHeader) + durations_size;
+	anchor_offset = (anchor_offset + gCurveFileAlignment - 1) / gCurveFileAlignment * gCurveFileAlignment;
+
+	tCurveFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.mMagic, gCurveFileMagic, sizeof(header.mMagic));
+	header.mVersion = gCurveFileVersion;
+	header.mEndianTag = gCurveFileEndianTag;
+	header.mCurveType = static_cast<int32_t>(mCurveType);
+	header.mDim = dim;
+	header.mNumAnchors = num_anchors;
+	header.mNumSegDurations = static_cast<int32_t>(durations.size());
+	header.mSegmentDuration = mSegmentDuration;
+	header.mAnchorOffset = anchor_offset;
+
+	std::ofstream f_stream(file.c_str(), std::ios::binary);
+	succ = f_stream.good();
 	if (succ)
 	{
-		// provides some examples of how to work with the anchor data structure
-		PrintAnchors();
+		const char padding[gCurveFileAlignment] = {};
+		size_t padding_size = anchor_offset - sizeof(tCurveFileHeader) - durations_size;
+		tConstAnchorMatrix anchor_pos = GetAnchorPositions();
+
+		f_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		f_stream.write(reinterpret_cast<const char*>(durations.data()), durations_size);
+		f_stream.write(padding, padding_size);
+		f_stream.write(reinterpret_cast<const char*>(anchor_pos.data()), dim * num_anchors * sizeof(double));
+		succ = f_stream.good();
 	}
-	else
+	f_stream.close();
+
+	if (!succ)
 	{
-		Clear();
+		printf("Failed to write curve to %s\n", file.c_str());
 	}
-
 	return succ;
 }
 
 void cCurve::Clear()
 {
-	mAnchors.clear();
+	mAnchorPos.resize(0, 0);
+	mAnchorTangents.resize(0, 0);
+	mAnchorFile.reset();
+	mMappedAnchorPos = nullptr;
+	mMappedDim = 0;
+	mMappedNumAnchors = 0;
+	mSegCoeffs.resize(0, 0);
+	mSegTimes.clear();
+	mArcLengths.clear();
 	mSegmentDuration = 1;
+	mUniformSegs = true;
+}
+
+void cCurve::SetCurveType(eCurveType curve_type)
+{
+	// changing the basis changes the number of segments, so everything is rebuilt
+	mCurveType = curve_type;
+	Rebuild();
+}
+
+cCurve::eCurveType cCurve::GetCurveType() const
+{
+	return mCurveType;
 }
 
 int cCurve::GetNumAnchors() const
 {
-	return static_cast<int>(mAnchors.size());
+	return static_cast<int>(GetAnchorPositions().cols());
 }
 
-const Eigen::VectorXd& cCurve::GetAnchorPos(int i) const
+cCurve::tConstAnchorView cCurve::GetAnchorPos(int i) const
 {
-	return mAnchors[i].mPos;
+	tConstAnchorMatrix anchor_pos = GetAnchorPositions();
+	return tConstAnchorView(anchor_pos.data() + i * anchor_pos.rows(), anchor_pos.rows());
 }
 
-const Eigen::VectorXd& cCurve::GetAnchorTangent(int i) const
+cCurve::tConstAnchorView cCurve::GetAnchorTangent(int i) const
 {
-	return mAnchors[i].mTangent;
+	return tConstAnchorView(mAnchorTangents.data() + i * mAnchorTangents.rows(), mAnchorTangents.rows());
+}
+
+cCurve::tConstAnchorMatrix cCurve::GetAnchorPositions() const
+{
+	if (mAnchorFile)
+	{
+		return tConstAnchorMatrix(mMappedAnchorPos, mMappedDim, mMappedNumAnchors);
+	}
+	return tConstAnchorMatrix(mAnchorPos.data(), mAnchorPos.rows(), mAnchorPos.cols());
+}
+
+const Eigen::MatrixXd& cCurve::GetAnchorTangents() const
+{
+	return mAnchorTangents;
 }
 
 int cCurve::GetNumSegments() const
@@ -130,442 +303,661 @@ int cCurve::GetNumSegments() const
 		break;
 	}
 
+	// B-splines extend past the end anchors, but a curve without anchors has nothing to extend
+	num_segs = (num_anchors > 0) ? num_segs : 0;
 	return num_segs;
 }
 
+double cCurve::GetSegTime(int seg) const
+{
+	// start time of a segment, seg == num segments gives the end time of the curve
+	assert(seg >= 0 && seg < static_cast<int>(mSegTimes.size()));
+	return mSegTimes[seg];
+}
+
 int cCurve::GetDim() const
 {
 	// dimension of each anchor
-	int dim = 0;
-	if (GetNumAnchors() > 0)
-	{
-		const auto& pos = GetAnchorPos(0);
-		dim = pos.size();
-	}
-	return dim;
+	return static_cast<int>(GetAnchorPositions().rows());
 }
 
-//Eigen::MatrixXd cCurve::GetGeometryMatrix(){
-	//int num_dim = GetDim();
-	//int num_anchors = GetNumAnchors();
-	
-//}
-
 void cCurve::Eval(double time, Eigen::VectorXd& out_result) const
 {
-	// TODO (CPSC426): Evaluates a parametric curve at the given time
-	out_result = Eigen::VectorXd::Zero(GetDim());
-	// Set each of out_result's dimensions to be time
-
-// G Matrix Construction
-	int numDim = GetDim();
-	int numAnc = GetNumAnchors();
-	Eigen::MatrixXd geometry_matrix(numAnc, numDim);
-
-	for (int i = 0; i < numAnc; i++){
-		const tAnchor& anchor = mAnchors[i];
-		for (int j = 0; j < numDim; j++){
-			geometry_matrix(i, j) = anchor.mPos[j];
-		}
-	}
-
-// Basis Matrix Construction B-SPLINE
-Eigen::Matrix4d basis_matrix_bird_bs;
-basis_matrix_bird_bs << -1.000, 3.000, -3.000, 1.000,
-						 3.000,-6.000,  3.000, 0.000,
-						-3.000, 0.000,  3.000, 0.000,
-						 1.000, 4.000,  1.000, 0.000;
-basis_matrix_bird_bs = 0.1666666667 * basis_matrix_bird_bs;
-
-// Basis Matrix Construction CATMULL_ROM
-Eigen::Matrix4d basis_matrix_bird_cr;
-basis_matrix_bird_cr << -1.0,  3.0, -3.0,  1.0,
-						 2.0, -5.0,  4.0, -1.0,
-						-1.0,  0.0,  1.0,  0.0,
-						 0.0,  2.0,  0.0,  0.0;
-basis_matrix_bird_cr = 0.5 * basis_matrix_bird_cr;
-
-// Time Vector Construction
-Eigen::Vector4d time_vector;
-
-double total_seg = 0;
-int n_seg;
-
-// for (n_seg = 0; n_seg < GetNumSegments(); n_seg++){
-// 	total_seg += GetSegDuration(n_seg);
-// 	//std::cout << (time - total_seg)/time << std::endl;
-// 	if((time - total_seg)/time <= 0){
-// 		break;
-// 	}
-// }
-for (n_seg = 0; n_seg < GetNumSegments(); n_seg++){
-	total_seg += GetSegDuration(n_seg);
-	//std::cout << total_seg << std::endl;
-	if(time <= total_seg){
-		break;
-	}
+	// evaluates a parametric curve at the given time
+	int seg = 0;
+	double u = 0;
+	FindSeg(time, seg, u);
+	EvalSeg(seg, u, out_result);
 }
 
-double t_seg = time - n_seg*GetSegDuration(n_seg);
-
-
-time_vector << t_seg*t_seg*t_seg, t_seg*t_seg, t_seg, 1;
+void cCurve::EvalTangent(double time, Eigen::VectorXd& out_result) const
+{
+	// evaluates the first derivative of a curve with respect to time
+	int seg = 0;
+	double u = 0;
+	FindSeg(time, seg, u);
+	EvalSegTangent(seg, u, out_result);
+}
 
-// Appended Vector Initialization
-Eigen::MatrixXd begin_vector(1, GetDim());
-Eigen::MatrixXd end_vector(1, GetDim());
+void cCurve::EvalNormal(double time, Eigen::VectorXd& out_result) const
+{
+	// evaluates the second derivative of a curve with respect to time
+	int seg = 0;
+	double u = 0;
+	FindSeg(time, seg, u);
+	EvalSegNormal(seg, u, out_result);
+}
 
-// Appended Vectors
-begin_vector << geometry_matrix.row(0);
-end_vector << geometry_matrix.row(GetNumAnchors()-1);
+void cCurve::EvalFrame(double time, Eigen::VectorXd& out_pos, Eigen::VectorXd& out_tangent, Eigen::VectorXd& out_normal) const
+{
+	// evaluates the position, first derivative and second derivative of the curve at the
+	// same time, sharing a single segment lookup between all three
+	int seg = 0;
+	double u = 0;
+	FindSeg(time, seg, u);
 
-// Geometry Matrix Initialization
-Eigen::MatrixXd geometry_matrix_begin_cr(numAnc+1, numDim);
-Eigen::MatrixXd geometry_matrix_end_cr(numAnc+1, numDim);
-geometry_matrix_begin_cr << begin_vector, geometry_matrix;
-geometry_matrix_end_cr << geometry_matrix, end_vector;
+	if (seg == gInvalidIdx)
+	{
+		int dim = GetDim();
+		out_pos = Eigen::VectorXd::Zero(dim);
+		out_tangent = Eigen::VectorXd::Zero(dim);
+		out_normal = Eigen::VectorXd::Zero(dim);
+		return;
+	}
 
-// Anchor Information
-int anchor_beg, anchor_end, anchor_beg_one;
-GetAnchors(n_seg, anchor_beg, anchor_end);
+	int dim = GetDim();
+	double du_dt = 1 / GetSegDuration(seg);
+	const double* coeffs = mSegCoeffs.data() + seg * gNumSegCoeffs * dim;
+	out_pos.resize(dim);
+	out_tangent.resize(dim);
+	out_normal.resize(dim);
+	mSegKernels->mEvalSeg(coeffs, dim, u, out_pos.data());
+	mSegKernels->mEvalSegTangent(coeffs, dim, u, du_dt, out_tangent.data());
+	mSegKernels->mEvalSegNormal(coeffs, dim, u, du_dt, out_normal.data());
+}
 
-// G Matrix Setting
-Eigen::MatrixXd geometry_matrix_bs(numAnc+4, numDim);
-Eigen::MatrixXd geometry_matrix_end_bs(numAnc+2, numDim);
-geometry_matrix_bs << begin_vector, begin_vector, geometry_matrix, end_vector, end_vector;
-geometry_matrix_end_bs << geometry_matrix, end_vector, end_vector;
+void cCurve::EvalBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const
+{
+	// evaluates the curve at a list of times, each column of out_result
+	// stores the value of the curve at the corresponding time
+	EvalBatch(times, 0, out_result);
+}
 
-switch (mCurveType)
+void cCurve::EvalTangentBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const
 {
-case eCurveTypeCatmullRom:
+	EvalBatch(times, 1, out_result);
+}
 
-if (n_seg == 0){
-		out_result = time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_begin_cr.block(0, 0, 4, GetDim());
+void cCurve::EvalNormalBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const
+{
+	EvalBatch(times, 2, out_result);
 }
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-		out_result = time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix.block(anchor_beg, 0, 4, GetDim());
+
+double cCurve::GetMaxTime() const
+{
+	// returns the total time needed to travel along the curve from start to end
+	double max_time = 0;
+	if (!mSegTimes.empty())
+	{
+		max_time = mSegTimes.back();
+	}
+	return max_time;
 }
-else if (n_seg == GetNumSegments()-1){
-		out_result = time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());
-} 
-break;
 
-case eCurveTypeBSpline:
+void cCurve::Tessellate(double max_err, Eigen::MatrixXd& out_pts) const
+{
+	// adaptively samples the curve into a polyline, each column of out_pts is a vertex
+	// every segment is recursively split in half until the midpoint of each piece
+	// lies within max_err of the midpoint of its chord, so straight stretches
+	// use few vertices while tight turns are sampled densely
+	int dim = GetDim();
+	int num_segs = GetNumSegments();
+	std::vector<double> pts;
+
+	if (num_segs > 0)
+	{
+		Eigen::VectorXd p0;
+		Eigen::VectorXd p1;
+		EvalSeg(0, 0, p0);
+		pts.insert(pts.end(), p0.data(), p0.data() + dim);
 
-if (n_seg == 0){
-	out_result = time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(0, 0, 4, GetDim());
-}
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-	if (anchor_beg == -1){
-		anchor_beg_one = 1;
-		out_result = time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(anchor_beg_one, 0, 4, GetDim());
+		for (int s = 0; s < num_segs; ++s)
+		{
+			EvalSeg(s, 1, p1);
+			TessellateSeg(s, 0, p0, 1, p1, 0, max_err, pts);
+			p0 = p1;
+		}
 	}
-	else
-		out_result = time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());	
+
+	int num_pts = (dim > 0) ? static_cast<int>(pts.size()) / dim : 0;
+	out_pts = Eigen::Map<const Eigen::MatrixXd>(pts.data(), dim, num_pts);
 }
-else if (n_seg == GetNumSegments()-1){
-		out_result = time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_bs.block(anchor_beg, 0, 4, GetDim());
-} break;
-default:
-	assert(false); // unsupported curve type
-	break;
+
+double cCurve::GetArcLength() const
+{
+	// total length of the curve
+	double len = 0;
+	if (!mArcLengths.empty())
+	{
+		len = mArcLengths.back();
 	}
+	return len;
 }
 
-void cCurve::EvalTangent(double time, Eigen::VectorXd& out_result) const
+double cCurve::CalcArcLength(double time) const
 {
-	// TODO (CPSC426): Evaluates the first derivative of a curve
-	//out_result = Eigen::VectorXd::Zero(GetDim()); // stub
-	// out_result[0] = 1;
+	// length of the curve from the start to the given time
+	int seg = 0;
+	double u = 0;
+	FindSeg(time, seg, u);
 
-	int numDim = GetDim();
-	int numAnc = GetNumAnchors();
-	Eigen::MatrixXd geometry_matrix(numAnc, numDim);
-
-	for (int i = 0; i < numAnc; i++){
-		const tAnchor& anchor = mAnchors[i];
-		for (int j = 0; j < numDim; j++){
-			geometry_matrix(i, j) = anchor.mPos[j];
-		}
+	double len = 0;
+	if (seg != gInvalidIdx)
+	{
+		int step = cMathUtil::Clamp(static_cast<int>(u * gArcLengthSteps), 0, gArcLengthSteps - 1);
+		double step_u = static_cast<double>(step) / gArcLengthSteps;
+		len = mArcLengths[seg * gArcLengthSteps + step] + CalcSegArcLength(seg, step_u, u);
 	}
+	return len;
+}
 
-// Basis Matrix Construction B-SPLINE
-Eigen::Matrix4d basis_matrix_bird_bs;
-basis_matrix_bird_bs << -1.000, 3.000, -3.000, 1.000,
-						 3.000,-6.000,  3.000, 0.000,
-						-3.000, 0.000,  3.000, 0.000,
-						 1.000, 4.000,  1.000, 0.000;
-
-// Basis Matrix Construction CATMULL_ROM
-Eigen::Matrix4d basis_matrix_bird_cr;
-basis_matrix_bird_cr << -1.000,  3.000, -3.000,  1.000,
-						 2.000, -5.000,  4.000, -1.000,
-						-1.000,  0.000,  1.000,  0.000,
-						 0.000,  2.000,  0.000,  0.000;
+double cCurve::CalcArcLengthTime(double dist, bool refine) const
+{
+	// finds the time at which the curve has traveled a given distance from the start
+	// the arc length table provides an initial guess by linear interpolation,
+	// which can then be refined with a few newton steps
+	int num_entries = static_cast<int>(mArcLengths.size());
+	if (num_entries < 2)
+	{
+		return 0;
+	}
 
-// Time Vector Construction
-Eigen::Vector4d tangent_time_vector;
+	dist = cMathUtil::Clamp(dist, 0.0, GetArcLength());
+	auto entry_end = std::upper_bound(mArcLengths.begin(), mArcLengths.end(), dist);
+	int idx = static_cast<int>(entry_end - mArcLengths.begin()) - 1;
+	idx = cMathUtil::Clamp(idx, 0, num_entries - 2);
 
-//int n_seg = (int) time;
+	int seg = idx / gArcLengthSteps;
+	int step = idx % gArcLengthSteps;
+	double len0 = mArcLengths[idx];
+	double len1 = mArcLengths[idx + 1];
+	double u0 = static_cast<double>(step) / gArcLengthSteps;
+	double u1 = static_cast<double>(step + 1) / gArcLengthSteps;
 
-int total_seg = 0;
-int n_seg;
+	double lerp = (len1 > len0) ? (dist - len0) / (len1 - len0) : 0;
+	double u = cMathUtil::Lerp(lerp, u0, u1);
 
-for (n_seg = 0; n_seg < GetNumSegments(); n_seg++){
-	total_seg += GetSegDuration(n_seg);
-	if((time - total_seg)/time <= 0){
-		break;
+	if (refine)
+	{
+		for (int i = 0; i < gArcLengthNewtonIters; ++i)
+		{
+			double err = len0 + CalcSegArcLength(seg, u0, u) - dist;
+			double speed = CalcSegSpeed(seg, u);
+			if (speed <= 0)
+			{
+				break;
+			}
+			u = cMathUtil::Clamp(u - err / speed, u0, u1);
+		}
 	}
-}
-double t_seg = time-n_seg;
-tangent_time_vector << 3*t_seg*t_seg, 2*t_seg, 1.000, 0.000;
 
-Eigen::MatrixXd begin_vector(1, GetDim());
-Eigen::MatrixXd end_vector(1, GetDim());
-
-// Appended Vectors
-begin_vector << geometry_matrix.row(0);
-end_vector << geometry_matrix.row(GetNumAnchors()-1);
+	double time = mSegTimes[seg] + u * GetSegDuration(seg);
+	return time;
+}
 
-// Appended Matrices
-Eigen::MatrixXd geometry_matrix_begin_cr(numAnc+1, numDim);
-Eigen::MatrixXd geometry_matrix_end_cr(numAnc+1, numDim);
-geometry_matrix_begin_cr << begin_vector, geometry_matrix;
-geometry_matrix_end_cr << geometry_matrix, end_vector;
+void cCurve::Add(const tAnchor& anchor)
+{
+	UnmapAnchors();
 
-// Get Anchor Information
-int anchor_beg, anchor_end, anchor_beg_one;
-GetAnchors(n_seg, anchor_beg, anchor_end);
+	// the first anchor determines the dimension of the curve
+	int idx = GetNumAnchors();
+	int dim = (idx > 0) ? GetDim() : static_cast<int>(anchor.mPos.size());
+	assert(anchor.mPos.size() == dim);
 
-// Setting of matrices 
-Eigen::MatrixXd geometry_matrix_bs(numAnc+4, numDim);
-Eigen::MatrixXd geometry_matrix_end_bs(numAnc+2, numDim);
-geometry_matrix_bs << begin_vector, begin_vector, geometry_matrix, end_vector, end_vector;
-geometry_matrix_end_bs << geometry_matrix, end_vector, end_vector;
+	mAnchorPos.conservativeResize(dim, idx + 1);
+	mAnchorTangents.conservativeResize(dim, idx + 1);
+	mAnchorPos.col(idx) = anchor.mPos;
+	mAnchorTangents.col(idx).setZero();
 
-switch (mCurveType)
-{
-case eCurveTypeCatmullRom:
+	// only the trailing segments supported by the new anchor need to be rebuilt,
+	// this includes segments that previously clamped to the old last anchor
+	int num_anchors = GetNumAnchors();
+	int num_segs = std::max(0, GetNumSegments());
+	int seg_beg = num_segs;
+	while (seg_beg > 0)
+	{
+		int anchor_beg = 0;
+		int anchor_end = 0;
+		GetAnchors(seg_beg - 1, anchor_beg, anchor_end);
+		if (anchor_end < num_anchors - 1)
+		{
+			break;
+		}
+		--seg_beg;
+	}
 
-if (n_seg == 0){
-	out_result = 0.5 * tangent_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_begin_cr.block(0, 0, 4, GetDim());
-} 	
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-		out_result = 0.5 * tangent_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix.block(anchor_beg, 0, 4, GetDim());
+	BuildSegTimes();
+	mSegKernels = &GetSegKernels(mCurveType, GetDim());
+	mSegCoeffs.conservativeResize(GetDim(), gNumSegCoeffs * num_segs);
+	for (int s = seg_beg; s < num_segs; ++s)
+	{
+		BuildSegCoeffs(s);
 	}
-else if (n_seg == GetNumSegments()-1){
-	out_result = 0.5 * tangent_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());
-} 
-break;
+	BuildArcLengths(seg_beg);
 
-case eCurveTypeBSpline:
+	if (num_anchors - 1 != num_segs)
+	{
+		// anchors are spread over the segments in proportion to the number of anchors,
+		// so when the two differ the time of every anchor moves
+		ComputeAnchorTangents();
+	}
+	else
+	{
+		ComputeAnchorTangents(seg_beg, num_segs);
+	}
 
-if (n_seg == 0){
-	out_result = 0.1666666667 * tangent_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(0, 0, 4, GetDim());
-}
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-	if (anchor_beg == -1){
-		anchor_beg_one = 1;
-		out_result = 0.1666666667 * tangent_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(anchor_beg_one, 0, 4, GetDim());
+	if (anchor.mTangent.size() == dim)
+	{
+		mAnchorTangents.col(idx) = anchor.mTangent;
 	}
-	else 
-	out_result = 0.1666666667 * tangent_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());	
 }
-else if (n_seg == GetNumSegments()-1){
-	out_result = 0.1666666667 * tangent_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_bs.block(anchor_beg, 0, 4, GetDim());
-} 
-break;
 
-default:
-	assert(false); // unsupported curve type
-	break;
+void cCurve::InsertAnchor(int i, const Eigen::VectorXd& pos)
+{
+	// inserts a new anchor before anchor i, only the segments supported by the
+	// new anchor are rebuilt, the rest of the curve is shifted over by one segment
+	UnmapAnchors();
+	int num_anchors = GetNumAnchors();
+	int dim = (num_anchors > 0) ? GetDim() : static_cast<int>(pos.size());
+	assert(i >= 0 && i <= num_anchors);
+	assert(pos.size() == dim);
+
+	int prev_num_segs = std::max(0, GetNumSegments());
+	int num_tail = num_anchors - i;
+	mAnchorPos.conservativeResize(dim, num_anchors + 1);
+	mAnchorPos.rightCols(num_tail) = mAnchorPos.middleCols(i, num_tail).eval();
+	mAnchorPos.col(i) = pos;
+	mAnchorTangents.conservativeResize(dim, num_anchors + 1);
+	mAnchorTangents.rightCols(num_tail) = mAnchorTangents.middleCols(i, num_tail).eval();
+	mAnchorTangents.col(i).setZero();
+
+	int num_segs = std::max(0, GetNumSegments());
+	if (num_anchors == 0 || prev_num_segs == 0 || num_segs != prev_num_segs + 1)
+	{
+		// the number of segments of very short curves does not follow the number of anchors
+		Rebuild();
+		return;
 	}
-}
 
+	InsertSeg(GetAnchorSeg(i));
 
-void cCurve::EvalNormal(double time, Eigen::VectorXd& out_result) const
+	int seg_beg = 0;
+	int seg_end = 0;
+	GetAnchorSegs(i, seg_beg, seg_end);
+	RebuildSegs(seg_beg, seg_end);
+
+	if (GetNumAnchors() - 1 != num_segs)
+	{
+		// anchors are spread over the segments in proportion to the number of anchors,
+		// so when the two differ the time of every anchor moves
+		ComputeAnchorTangents();
+	}
+}
+
+void cCurve::MoveAnchor(int i, const Eigen::VectorXd& pos)
 {
-	//out_result = Eigen::VectorXd::Zero(GetDim()); // stub
-	//out_result[0] = 1;
+	// moves anchor i, only the segments supported by the anchor are rebuilt
+	UnmapAnchors();
+	assert(i >= 0 && i < GetNumAnchors());
+	assert(pos.size() == GetDim());
+	mAnchorPos.col(i) = pos;
+
+	int seg_beg = 0;
+	int seg_end = 0;
+	GetAnchorSegs(i, seg_beg, seg_end);
+	RebuildSegs(seg_beg, seg_end);
+}
 
-	int numDim = GetDim();
-	int numAnc = GetNumAnchors();
-	Eigen::MatrixXd geometry_matrix(numAnc, numDim);
+void cCurve::RemoveAnchor(int i)
+{
+	// removes anchor i, only the segments supported by the neighbours of the
+	// removed anchor are rebuilt, the rest of the curve is shifted back by one segment
+	UnmapAnchors();
+	int num_anchors = GetNumAnchors();
+	int dim = GetDim();
+	assert(i >= 0 && i < num_anchors);
 
-	for (int i = 0; i < numAnc; i++){
-		const tAnchor& anchor = mAnchors[i];
-		for (int j = 0; j < numDim; j++){
-			geometry_matrix(i, j) = anchor.mPos[j];
-		}
-	}
+	int prev_num_segs = std::max(0, GetNumSegments());
+	int removed_seg = GetAnchorSeg(i);
 
-// Basis Matrix Construction B-SPLINE
-Eigen::Matrix4d basis_matrix_bird_bs;
-basis_matrix_bird_bs << -1.000, 3.000, -3.000, 1.000,
-						 3.000,-6.000,  3.000, 0.000,
-						-3.000, 0.000,  3.000, 0.000,
-						 1.000, 4.000,  1.000, 0.000;
+	int num_tail = num_anchors - i - 1;
+	mAnchorPos.middleCols(i, num_tail) = mAnchorPos.rightCols(num_tail).eval();
+	mAnchorPos.conservativeResize(dim, num_anchors - 1);
+	mAnchorTangents.middleCols(i, num_tail) = mAnchorTangents.rightCols(num_tail).eval();
+	mAnchorTangents.conservativeResize(dim, num_anchors - 1);
 
-// Basis Matrix Construction CATMULL_ROM
-Eigen::Matrix4d basis_matrix_bird_cr;
-basis_matrix_bird_cr << -1.000,  3.000, -3.000,  1.000,
-						 2.000, -5.000,  4.000, -1.000,
-						-1.000,  0.000,  1.000,  0.000,
-						 0.000,  2.000,  0.000,  0.000;
+	int num_segs = std::max(0, GetNumSegments());
+	if (num_anchors == 1 || num_segs == 0 || num_segs != prev_num_segs - 1)
+	{
+		Rebuild();
+		return;
+	}
 
+	RemoveSeg(removed_seg);
 
-// Time Vector Construction
-//Eigen::Vector4d tangent_time_vector;
-//int n_seg = (int) time;
-int total_seg = 0;
-int n_seg;
+	// the neighbours of the removed anchor are now anchors i - 1 and i
+	int seg_beg = 0;
+	int seg_end = 0;
+	int unused = 0;
+	GetAnchorSegs(std::max(i - 1, 0), seg_beg, unused);
+	GetAnchorSegs(std::min(i, GetNumAnchors() - 1), unused, seg_end);
+	RebuildSegs(seg_beg, seg_end);
 
-for (n_seg = 0; n_seg < GetNumSegments(); n_seg++){
-	total_seg += GetSegDuration(n_seg);
-	if((time - total_seg)/time <= 0){
-		break;
+	if (GetNumAnchors() - 1 != num_segs)
+	{
+		// anchors are spread over the segments in proportion to the number of anchors,
+		// so when the two differ the time of every anchor moves
+		ComputeAnchorTangents();
 	}
 }
-double t_seg = time-n_seg;
-//float t_seg = time - GetSegDuration(n_seg);
-Eigen::Vector4d normal_time_vector;
 
-normal_time_vector << 6*t_seg, 2.000, 0.000, 0.000;
+bool cCurve::IsBinaryFile(const std::string& file)
+{
+	// binary curve files are recognized by the magic number at the start of the file
+	char magic[sizeof(gCurveFileMagic)] = {};
+	std::ifstream f_stream(file.c_str(), std::ios::binary);
+	f_stream.read(magic, sizeof(magic));
+	bool is_binary = f_stream.good() && (memcmp(magic, gCurveFileMagic, sizeof(magic)) == 0);
+	f_stream.close();
+	return is_binary;
+}
 
-Eigen::MatrixXd begin_vector(1, GetDim());
-Eigen::MatrixXd end_vector(1, GetDim());
+bool cCurve::LoadJson(const std::string& file)
+{
+	// the anchors make up nearly all of a curve file, so they are streamed straight
+	// into the anchor matrix, while jsoncpp only parses the remaining header parameters
+	std::ifstream f_stream(file.c_str(), std::ios::binary);
+	bool succ = f_stream.good();
+	std::string text;
+	if (succ)
+	{
+		f_stream.seekg(0, std::ios::end);
+		text.resize(static_cast<size_t>(f_stream.tellg()));
+		f_stream.seekg(0, std::ios::beg);
+		f_stream.read(&text[0], text.size());
+		succ = !f_stream.fail();
+	}
+	f_stream.close();
 
-begin_vector << geometry_matrix.row(0);
-end_vector << geometry_matrix.row(GetNumAnchors()-1);
+	Json::Value root(Json::objectValue);
+	if (succ)
+	{
+		// the members of the curve are visited in a single pass, the anchors are parsed
+		// into the anchor matrix and only the values of the other members go to jsoncpp
+		cJsonStream stream(text.data(), text.size());
+		succ = stream.Consume('{');
+		if (succ && !stream.Consume('}'))
+		{
+			do
+			{
+				std::string key;
+				succ = stream.ReadString(key) && stream.Consume(':');
+				if (succ && key == gAnchorsKey)
+				{
+					succ = ParseAnchors(stream);
+				}
+				else if (succ)
+				{
+					size_t value_beg = stream.GetPos();
+					succ = stream.SkipValue();
+					if (succ)
+					{
+						Json::Reader reader;
+						succ = reader.parse(text.data() + value_beg, text.data() + stream.GetPos(), root[key]);
+					}
+				}
+			} while (succ && stream.Consume(','));
+
+			succ = succ && stream.Consume('}');
+		}
+	}
 
-Eigen::MatrixXd geometry_matrix_begin_cr(numAnc+1, numDim);
-Eigen::MatrixXd geometry_matrix_end_cr(numAnc+1, numDim);
-int anchor_beg, anchor_end, anchor_beg_one;
-geometry_matrix_begin_cr << begin_vector, geometry_matrix;
-geometry_matrix_end_cr << geometry_matrix, end_vector;
-GetAnchors(n_seg, anchor_beg, anchor_end);
+	if (succ)
+	{
+		// parse misc parameters from the file
+		std::string type_str = root.get(gTypeKey, "").asString();
+		mCurveType = ParseCurveType(type_str);
+		mSegmentDuration = root.get(gSegmentDurationKey, 1).asDouble();
 
-Eigen::MatrixXd geometry_matrix_bs(numAnc+4, numDim);
-Eigen::MatrixXd geometry_matrix_end_bs(numAnc+2, numDim);
-geometry_matrix_bs << begin_vector, begin_vector, geometry_matrix, end_vector, end_vector;
-geometry_matrix_end_bs << geometry_matrix, end_vector, end_vector;
+		// segment durations can only be checked once the number of segments is known
+		succ &= ParseSegDurations(root);
+	}
 
+	return succ;
+}
 
-switch (mCurveType)
+bool cCurve::LoadBinary(const std::string& file)
 {
-case eCurveTypeCatmullRom:
+	// maps a binary curve file into memory, the anchor positions are used
+	// in place, so the cost of loading is mostly the cost of paging in the anchors
+	std::shared_ptr<cMappedFile> mapped_file = std::make_shared<cMappedFile>();
+	bool succ = mapped_file->Open(file);
 
-if (n_seg == 0){
-	out_result = 0.5 * normal_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_begin_cr.block(0, 0, 4, GetDim());
-}
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-		out_result = 0.5 * normal_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix.block(anchor_beg, 0, 4, GetDim());
-}
-else if (n_seg == GetNumSegments()-1){
-	out_result = 0.5 * normal_time_vector.transpose() * basis_matrix_bird_cr * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());
-} 
-break;
+	tCurveFileHeader header;
+	if (succ)
+	{
+		succ = mapped_file->GetSize() >= sizeof(header);
+		if (succ)
+		{
+			memcpy(&header, mapped_file->GetData(), sizeof(header));
+		}
+	}
+
+	if (succ)
+	{
+		succ = (memcmp(header.mMagic, gCurveFileMagic, sizeof(header.mMagic)) == 0)
+			&& (header.mVersion == gCurveFileVersion);
+		if (!succ)
+		{
+			printf("Unsupported curve file version in %s\n", file.c_str());
+		}
+	}
 
-case eCurveTypeBSpline:
+	if (succ)
+	{
+		succ = header.mEndianTag == gCurveFileEndianTag;
+		if (!succ)
+		{
+			printf("Curve file %s does not match the byte order of this machine\n", file.c_str());
+		}
+	}
 
-if (n_seg == 0){
-	out_result = 0.1666666667 * normal_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(0, 0, 4, GetDim());
-}
-else if (0 < n_seg && n_seg < GetNumSegments()-1){
-	if (anchor_beg == -1){
-		anchor_beg_one = 1;
-		out_result = 0.1666666667 * normal_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_bs.block(anchor_beg_one, 0, 4, GetDim());
+	if (succ)
+	{
+		size_t durations_end = sizeof(header) + header.mNumSegDurations * sizeof(double);
+		size_t anchors_size = static_cast<size_t>(header.mDim) * header.mNumAnchors * sizeof(double);
+		succ = (header.mCurveType >= 0) && (header.mCurveType < eCurveTypeMax)
+			&& (header.mDim >= 0) && (header.mNumAnchors >= 0) && (header.mNumSegDurations >= 0)
+			&& (header.mAnchorOffset % sizeof(double) == 0)
+			&& (header.mAnchorOffset >= durations_end)
+			&& (header.mAnchorOffset + anchors_size <= mapped_file->GetSize());
+		if (!succ)
+		{
+			printf("Corrupt curve file %s\n", file.c_str());
+			assert(false);
+		}
 	}
-	else 
-	out_result = 0.1666666667 * normal_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_cr.block(anchor_beg, 0, 4, GetDim());	
-}
-else if (n_seg == GetNumSegments()-1){
-	out_result = 0.1666666667 * normal_time_vector.transpose() * basis_matrix_bird_bs * geometry_matrix_end_bs.block(anchor_beg, 0, 4, GetDim());
-} 
-break;
 
-default:
-	assert(false); // unsupported curve type
-	break;
+	if (succ)
+	{
+		mCurveType = static_cast<eCurveType>(header.mCurveType);
+		mSegmentDuration = header.mSegmentDuration;
+
+		mAnchorFile = mapped_file;
+		mMappedAnchorPos = reinterpret_cast<const double*>(mapped_file->GetData() + header.mAnchorOffset);
+		mMappedDim = header.mDim;
+		mMappedNumAnchors = header.mNumAnchors;
+		mAnchorTangents = Eigen::MatrixXd::Zero(header.mDim, header.mNumAnchors);
+
+		mSegTimes.clear();
+		if (header.mNumSegDurations > 0)
+		{
+			std::vector<double> durations(header.mNumSegDurations);
+			memcpy(durations.data(), mapped_file->GetData() + sizeof(header), durations.size() * sizeof(double));
+			succ = SetSegDurations(durations);
+		}
+		else
+		{
+			BuildSegTimes();
+		}
 	}
-}
 
-double cCurve::GetMaxTime() const
-{
-	// returns the total time needed to travel along the curve from start to end
-	return mSegmentDuration * GetNumSegments();
+	return succ;
 }
 
-void cCurve::Add(const tAnchor& anchor)
+void cCurve::UnmapAnchors()
 {
-	mAnchors.push_back(anchor);
+	// copies anchors that are mapped from a binary curve file into
+	// memory owned by the curve, so that they can be edited
+	if (mAnchorFile)
+	{
+		mAnchorPos = GetAnchorPositions();
+		mAnchorFile.reset();
+		mMappedAnchorPos = nullptr;
+		mMappedDim = 0;
+		mMappedNumAnchors = 0;
+	}
 }
 
-bool cCurve::ParseAnchors(const Json::Value& root)
+bool cCurve::ParseAnchors(cJsonStream& stream)
 {
-	// parses an array of anchors from root
-
-	assert(root.isArray());
-	bool succ = true;
-
-	int num_anchors = root.size();
-	mAnchors.resize(num_anchors);
+	// parses an array of anchors from the stream
+	// the anchors are counted in a first pass, so that the positions can then
+	// be parsed straight into the columns of the anchor matrix
 
 	// anchors are stored as a list of points
 	// the points can be of any dimension, but the dimensions of
 	// all points should be the same
-	for (int i = 0; i < num_anchors; ++i)
+	size_t array_beg = stream.GetPos();
+	int num_anchors = 0;
+	int dim = 0;
+	int anchor = 0;
+	bool succ = stream.Consume('[');
+	if (succ && !stream.Consume(']'))
 	{
-		const auto& anchor_json = root.get(i, 0);
-		tAnchor& curr_anchor = mAnchors[i];
-		succ &= ParseAnchor(anchor_json, curr_anchor);
+		do
+		{
+			// the first anchor is only read to find the dimension of the points
+			succ = (num_anchors == 0) ? ParseAnchor(stream, nullptr, 0, dim) : stream.SkipValue();
+			anchor = num_anchors;
+			++num_anchors;
+		} while (succ && stream.Consume(','));
+
+		succ = succ && stream.Consume(']');
 	}
 
 	if (succ)
 	{
-		// compute and store the tangents at the achor points
-		// these achnor tangets are currently used only for visualization
-		ComputeAnchorTangents();
+		size_t array_end = stream.GetPos();
+		stream.SetPos(array_beg);
+		stream.Consume('[');
+
+		mAnchorPos.resize(dim, num_anchors);
+		for (anchor = 0; anchor < num_anchors && succ; ++anchor)
+		{
+			int curr_dim = 0;
+			succ = (anchor == 0 || stream.Consume(','))
+					&& ParseAnchor(stream, mAnchorPos.col(anchor).data(), dim, curr_dim);
+
+			if (succ && curr_dim != dim)
+			{
+				printf("Anchor dimension mismatch, expecting %i got %i\n", dim, curr_dim);
+				assert(false);
+				succ = false;
+			}
+		}
+		--anchor;
+		stream.SetPos(array_end);
+	}
+
+	if (succ)
+	{
+		mAnchorTangents = Eigen::MatrixXd::Zero(dim, num_anchors);
+	}
+	else
+	{
+		printf("Failed to parse anchor %i\n", anchor);
 	}
 
 	return succ;
 }
 
-bool cCurve::ParseAnchor(const Json::Value& root, tAnchor& out_anchor) const
+bool cCurve::ParseSegDurations(const Json::Value& root)
 {
-	// parse anchors specified using a JSON format
+	// segments default to SegmentDuration, but the duration of each segment
+	// can also be specified individually with a SegmentDurations array
 	bool succ = true;
-	if (!root[gAnchorPosKey].isNull())
-	{
-		const auto& pos_json = root.get(gAnchorPosKey, 0);
-		int curr_dim = pos_json.size();
-		out_anchor.mPos.resize(curr_dim);
+	mSegTimes.clear();
 
-		int dim = GetDim();
-		succ = curr_dim == dim;
-		if (!succ)
-		{
-			printf("Anchor dimension mismatch, expecting %i got %i\n", dim, curr_dim);
-			assert(false);
-		}
+	if (!root[gSegmentDurationsKey].isNull())
+	{
+		const auto& durations_json = root.get(gSegmentDurationsKey, 0);
+		succ = durations_json.isArray();
 
 		if (succ)
 		{
-			// each anchor is defined as a list of numbers
-			for (int i = 0; i < curr_dim; ++i)
+			int num_durations = durations_json.size();
+			std::vector<double> durations(num_durations);
+			for (int i = 0; i < num_durations; ++i)
 			{
-				out_anchor.mPos[i] = pos_json.get(i, 0).asDouble();
+				durations[i] = durations_json.get(i, 0).asDouble();
 			}
+			succ = SetSegDurations(durations);
 		}
 	}
 	else
 	{
-		succ = false;
+		BuildSegTimes();
 	}
 
 	return succ;
 }
 
+bool cCurve::ParseAnchor(cJsonStream& stream, double* out_pos, int max_dim, int& out_dim) const
+{
+	// each anchor is an object with its position defined as a list of numbers,
+	// which are written to out_pos without creating intermediate values,
+	// out_dim is the number of values in the position even if it exceeds max_dim
+	bool found_pos = false;
+	out_dim = 0;
+	bool succ = stream.Consume('{');
+
+	if (succ && !stream.Consume('}'))
+	{
+		do
+		{
+			std::string key;
+			succ = stream.ReadString(key) && stream.Consume(':');
+			if (succ)
+			{
+				if (key == gAnchorPosKey)
+				{
+					succ = stream.ReadNumberArray(out_pos, max_dim, out_dim);
+					found_pos = true;
+				}
+				else
+				{
+					succ = stream.SkipValue();
+				}
+			}
+		} while (succ && stream.Consume(','));
+
+		succ = succ && stream.Consume('}');
+	}
+
+	return succ && found_pos;
+}
+
 void cCurve::PrintAnchors() const
 {
 	// prints out the positions of all anchors
@@ -575,13 +967,12 @@ void cCurve::PrintAnchors() const
 	printf("Curve Anchors:\n");
 	for (int i = 0; i < num_anchors; ++i)
 	{
-		const tAnchor& anchor = mAnchors[i];
 		printf("Anchor %i:\t", i);
 
 		// print the position of each anchor
 		for (int j = 0; j < dim; ++j)
 		{
-			printf("%.3f\t", anchor.mPos[j]);
+			printf("%.3f\t", GetAnchorPos(i)[j]);
 		}
 		printf("\n");
 	}
@@ -611,26 +1002,556 @@ double cCurve::GetAnchorTime(int i) const
 {
 	// computes the time for a given anchor
 	// i.e. roughly the time when a point will be at a particular anchor i
+	// the anchors are spread evenly over the segments and then mapped to time,
+	// so that anchors still line up with segment boundaries when durations vary
 	int num_anchors = GetNumAnchors();
-	double time = i / (num_anchors - 1.0);
-	time *= GetMaxTime();
+	int num_segs = GetNumSegments();
+	double time = 0;
+	if (num_anchors > 1 && num_segs > 0)
+	{
+		double seg_pos = (i * num_segs) / (num_anchors - 1.0);
+		int seg = cMathUtil::Clamp(static_cast<int>(seg_pos), 0, num_segs - 1);
+		time = mSegTimes[seg] + (seg_pos - seg) * GetSegDuration(seg);
+	}
 	return time;
 }
 
 void cCurve::ComputeAnchorTangents()
 {
 	// computes and stores the tangents at the anchor points
-	for (int i = 0; i < GetNumAnchors(); ++i)
+	int num_anchors = GetNumAnchors();
+	Eigen::VectorXd times(num_anchors);
+	for (int i = 0; i < num_anchors; ++i)
+	{
+		times[i] = GetAnchorTime(i);
+	}
+	EvalTangentBatch(times, mAnchorTangents);
+}
+
+void cCurve::ComputeAnchorTangents(int seg_beg, int seg_end)
+{
+	// recomputes the tangents of the anchors that are evaluated within segments [seg_beg, seg_end)
+	int num_anchors = GetNumAnchors();
+	int num_segs = GetNumSegments();
+	if (num_anchors < 2 || num_segs <= 0 || seg_beg >= seg_end)
 	{
-		double time = GetAnchorTime(i);
-		tAnchor& curr_anchor = mAnchors[i];
-		EvalTangent(time, curr_anchor.mTangent);
+		return;
+	}
+
+	// inverse of the mapping from anchors to segments in GetAnchorTime
+	double anchors_per_seg = (num_anchors - 1.0) / num_segs;
+	int anchor_beg = static_cast<int>(std::floor(seg_beg * anchors_per_seg));
+	int anchor_end = static_cast<int>(std::ceil(seg_end * anchors_per_seg)) + 1;
+	anchor_beg = cMathUtil::Clamp(anchor_beg, 0, num_anchors);
+	anchor_end = cMathUtil::Clamp(anchor_end, anchor_beg, num_anchors);
+
+	int num_updates = anchor_end - anchor_beg;
+	Eigen::VectorXd times(num_updates);
+	for (int i = 0; i < num_updates; ++i)
+	{
+		times[i] = GetAnchorTime(anchor_beg + i);
+	}
+
+	Eigen::MatrixXd tangents;
+	EvalTangentBatch(times, tangents);
+	mAnchorTangents.middleCols(anchor_beg, num_updates) = tangents;
+}
+
+void cCurve::GetAnchorSegs(int i, int& seg_beg, int& seg_end) const
+{
+	// computes the range of segments [seg_beg, seg_end) whose four-point support includes anchor i,
+	// segments past either end of the curve that clamp to the first or last anchor are included
+	int num_segs = std::max(0, GetNumSegments());
+	int anchor_beg = 0;
+	int anchor_end = 0;
+	GetAnchors(0, anchor_beg, anchor_end);
+
+	seg_beg = cMathUtil::Clamp(i - anchor_end, 0, num_segs);
+	seg_end = cMathUtil::Clamp(i - anchor_beg + 1, seg_beg, num_segs);
+}
+
+int cCurve::GetAnchorSeg(int i) const
+{
+	// the segment that is added or removed along with anchor i,
+	// i.e. the segment whose second supporting anchor is anchor i
+	int num_segs = std::max(0, GetNumSegments());
+	int anchor_beg = 0;
+	int anchor_end = 0;
+	GetAnchors(0, anchor_beg, anchor_end);
+	return cMathUtil::Clamp(i - anchor_beg - 1, 0, num_segs - 1);
+}
+
+void cCurve::FindSeg(double time, int& out_seg, double& out_u) const
+{
+	// finds the segment active at a given time and the normalized
+	// parameter u in [0, 1] within that segment
+	int num_segs = GetNumSegments();
+	out_seg = gInvalidIdx;
+	out_u = 0;
+
+	if (num_segs > 0)
+	{
+		double max_time = GetMaxTime();
+		time = cMathUtil::Clamp(time, 0.0, max_time);
+
+		int seg = 0;
+		if (mUniformSegs)
+		{
+			// all segments share the same duration, so the segment can be computed directly
+			seg = static_cast<int>(time / mSegmentDuration);
+		}
+		else
+		{
+			// binary search for the last segment that starts at or before time
+			auto seg_end = std::upper_bound(mSegTimes.begin(), mSegTimes.end(), time);
+			seg = static_cast<int>(seg_end - mSegTimes.begin()) - 1;
+		}
+		seg = cMathUtil::Clamp(seg, 0, num_segs - 1);
+
+		double seg_duration = GetSegDuration(seg);
+		double u = (time - mSegTimes[seg]) / seg_duration;
+		out_u = cMathUtil::Saturate(u);
+		out_seg = seg;
+	}
+}
+
+void cCurve::FindSeg(double time, int seg_hint, int& out_seg, double& out_u) const
+{
+	// same as FindSeg, but starts the search from seg_hint and steps to the neighbouring
+	// segments, so that lookups of nearby times (e.g. consecutive frames of playback)
+	// take amortized constant time even when segments have different durations
+	int num_segs = GetNumSegments();
+	if (mUniformSegs || num_segs <= 0 || seg_hint < 0 || seg_hint >= num_segs)
+	{
+		FindSeg(time, out_seg, out_u);
+		return;
+	}
+
+	double max_time = GetMaxTime();
+	time = cMathUtil::Clamp(time, 0.0, max_time);
+
+	int seg = seg_hint;
+	int steps = 0;
+	while ((seg < num_segs - 1) && (time >= mSegTimes[seg + 1]) && (steps < gSegSearchSteps))
+	{
+		++seg;
+		++steps;
+	}
+	while ((seg > 0) && (time < mSegTimes[seg]) && (steps < gSegSearchSteps))
+	{
+		--seg;
+		++steps;
+	}
+
+	bool in_seg = (time >= mSegTimes[seg]) && ((time < mSegTimes[seg + 1]) || (seg == num_segs - 1));
+	if (!in_seg)
+	{
+		FindSeg(time, out_seg, out_u);
+		return;
+	}
+
+	double u = (time - mSegTimes[seg]) / GetSegDuration(seg);
+	out_u = cMathUtil::Saturate(u);
+	out_seg = seg;
+}
+
+void cCurve::BuildSegCoeffs()
+{
+	// precomputes the polynomial coefficients of every segment
+	// so that evaluation does not need to touch the anchors
+	int num_segs = std::max(0, GetNumSegments());
+	mSegKernels = &GetSegKernels(mCurveType, GetDim());
+	mSegCoeffs.resize(GetDim(), gNumSegCoeffs * num_segs);
+
+	for (int s = 0; s < num_segs; ++s)
+	{
+		BuildSegCoeffs(s);
+	}
+}
+
+void cCurve::BuildSegCoeffs(int seg)
+{
+	// the coefficients are the basis matrix times the 4 anchors supporting the segment,
+	// with anchors past either end of the curve clamped to the first or last anchor
+	int dim = GetDim();
+	int num_anchors = GetNumAnchors();
+	int anchor_beg = 0;
+	int anchor_end = 0;
+	GetAnchors(seg, anchor_beg, anchor_end);
+
+	const double* anchors[gNumSegCoeffs];
+	for (int i = 0; i < gNumSegCoeffs; ++i)
+	{
+		int a = cMathUtil::Clamp(anchor_beg + i, 0, num_anchors - 1);
+		anchors[i] = GetAnchorPos(a).data();
+	}
+	mSegKernels->mBuildSegCoeffs(anchors, dim, mSegCoeffs.data() + seg * gNumSegCoeffs * dim);
+}
+
+void cCurve::EvalSeg(int seg, double u, Eigen::VectorXd& out_result) const
+{
+	int dim = GetDim();
+	out_result.resize(dim);
+	if (seg == gInvalidIdx)
+	{
+		out_result.setZero();
+		return;
+	}
+
+	// horner's rule on the cached coefficients
+	const double* coeffs = mSegCoeffs.data() + seg * gNumSegCoeffs * dim;
+	mSegKernels->mEvalSeg(coeffs, dim, u, out_result.data());
+}
+
+void cCurve::EvalSegTangent(int seg, double u, Eigen::VectorXd& out_result) const
+{
+	int dim = GetDim();
+	out_result.resize(dim);
+	if (seg == gInvalidIdx)
+	{
+		out_result.setZero();
+		return;
+	}
+
+	// dp/dt = dp/du * du/dt
+	double du_dt = 1 / GetSegDuration(seg);
+	const double* coeffs = mSegCoeffs.data() + seg * gNumSegCoeffs * dim;
+	mSegKernels->mEvalSegTangent(coeffs, dim, u, du_dt, out_result.data());
+}
+
+void cCurve::EvalSegNormal(int seg, double u, Eigen::VectorXd& out_result) const
+{
+	int dim = GetDim();
+	out_result.resize(dim);
+	if (seg == gInvalidIdx)
+	{
+		out_result.setZero();
+		return;
+	}
+
+	double du_dt = 1 / GetSegDuration(seg);
+	const double* coeffs = mSegCoeffs.data() + seg * gNumSegCoeffs * dim;
+	mSegKernels->mEvalSegNormal(coeffs, dim, u, du_dt, out_result.data());
+}
+
+void cCurve::TessellateSeg(int seg, double u0, const Eigen::VectorXd& p0, double u1, const Eigen::VectorXd& p1,
+							int depth, double max_err, std::vector<double>& out_pts) const
+{
+	// appends the vertices of the piece [u0, u1] of a segment to out_pts, excluding p0
+	// the midpoint is reused as an endpoint of both halves when the piece is split
+	double mid_u = 0.5 * (u0 + u1);
+	Eigen::VectorXd mid_p;
+	EvalSeg(seg, mid_u, mid_p);
+
+	double err = (mid_p - 0.5 * (p0 + p1)).norm();
+	bool split = (depth < gTessMinDepth) || ((err > max_err) && (depth < gTessMaxDepth));
+
+	if (split)
+	{
+		TessellateSeg(seg, u0, p0, mid_u, mid_p, depth + 1, max_err, out_pts);
+		TessellateSeg(seg, mid_u, mid_p, u1, p1, depth + 1, max_err, out_pts);
+	}
+	else
+	{
+		out_pts.insert(out_pts.end(), p1.data(), p1.data() + p1.size());
+	}
+}
+
+void cCurve::BuildArcLengths(int seg_beg, int seg_end)
+{
+	// re-integrates the arc length table entries of segments [seg_beg, seg_end)
+	// and shifts the entries of the segments that follow by the change in length
+	int num_segs = std::max(0, GetNumSegments());
+	seg_beg = cMathUtil::Clamp(seg_beg, 0, num_segs);
+	seg_end = cMathUtil::Clamp(seg_end, seg_beg, num_segs);
+	assert(static_cast<int>(mArcLengths.size()) == num_segs * gArcLengthSteps + 1);
+
+	int end_idx = seg_end * gArcLengthSteps;
+	double prev_len = mArcLengths[end_idx];
+	for (int s = seg_beg; s < seg_end; ++s)
+	{
+		for (int i = 0; i < gArcLengthSteps; ++i)
+		{
+			int idx = s * gArcLengthSteps + i;
+			double u0 = static_cast<double>(i) / gArcLengthSteps;
+			double u1 = static_cast<double>(i + 1) / gArcLengthSteps;
+			mArcLengths[idx + 1] = mArcLengths[idx] + CalcSegArcLength(s, u0, u1);
+		}
+	}
+
+	double delta = mArcLengths[end_idx] - prev_len;
+	for (size_t idx = end_idx + 1; idx < mArcLengths.size(); ++idx)
+	{
+		mArcLengths[idx] += delta;
+	}
+}
+
+void cCurve::BuildArcLengths(int seg_beg)
+{
+	// rebuilds the arc length table from segment seg_beg to the end of the curve
+	// each entry stores the length of the curve from the start up to that entry
+	int num_segs = std::max(0, GetNumSegments());
+	seg_beg = cMathUtil::Clamp(seg_beg, 0, num_segs);
+	mArcLengths.resize(num_segs * gArcLengthSteps + 1);
+	mArcLengths[0] = 0;
+
+	for (int s = seg_beg; s < num_segs; ++s)
+	{
+		for (int i = 0; i < gArcLengthSteps; ++i)
+		{
+			int idx = s * gArcLengthSteps + i;
+			double u0 = static_cast<double>(i) / gArcLengthSteps;
+			double u1 = static_cast<double>(i + 1) / gArcLengthSteps;
+			mArcLengths[idx + 1] = mArcLengths[idx] + CalcSegArcLength(s, u0, u1);
+		}
+	}
+}
+
+double cCurve::CalcSegArcLength(int seg, double u0, double u1) const
+{
+	// integrates the speed of a segment between u0 and u1 with gauss-legendre quadrature
+	double half_len = 0.5 * (u1 - u0);
+	double mid = 0.5 * (u1 + u0);
+	double len = 0;
+	for (int i = 0; i < gNumQuadPts; ++i)
+	{
+		double u = mid + half_len * gQuadPts[i];
+		len += gQuadWeights[i] * CalcSegSpeed(seg, u);
+	}
+	len *= half_len;
+	return len;
+}
+
+double cCurve::CalcSegSpeed(int seg, double u) const
+{
+	// magnitude of the derivative of a segment with respect to u
+	const auto& coeffs = mSegCoeffs.middleCols(seg * gNumSegCoeffs, gNumSegCoeffs);
+	return (((3 * u) * coeffs.col(0) + 2 * coeffs.col(1)) * u + coeffs.col(2)).norm();
+}
+
+void cCurve::EvalBatch(const Eigen::VectorXd& times, int deriv, Eigen::MatrixXd& out_result) const
+{
+	// evaluates the deriv-th derivative of the curve at a list of times
+	// consecutive times that fall in the same segment are grouped together so that each group
+	// can be evaluated as a single product of the segment coefficients with the power basis
+	// of the group, i.e. [dim x 4] * [4 x group size], which is vectorized by Eigen
+	int num_samples = static_cast<int>(times.size());
+	int num_segs = GetNumSegments();
+	out_result.resize(GetDim(), num_samples);
+
+	if (num_segs <= 0)
+	{
+		out_result.setZero();
+		return;
+	}
+
+	double max_time = GetMaxTime();
+	Eigen::MatrixXd time_basis(gNumSegCoeffs, num_samples);
+
+	int i = 0;
+	while (i < num_samples)
+	{
+		int seg = 0;
+		double u = 0;
+		FindSeg(times[i], seg, u);
+
+		double seg_beg = mSegTimes[seg];
+		double seg_end = mSegTimes[seg + 1];
+		double du_dt = 1 / (seg_end - seg_beg);
+		bool is_last_seg = (seg == num_segs - 1);
+		int group_beg = i;
+
+		while (i < num_samples)
+		{
+			double time = cMathUtil::Clamp(times[i], 0.0, max_time);
+			bool in_seg = (i == group_beg) 
+						|| ((time >= seg_beg) && ((time < seg_end) || is_last_seg));
+			if (!in_seg)
+			{
+				break;
+			}
+
+			u = cMathUtil::Saturate((time - seg_beg) * du_dt);
+			switch (deriv)
+			{
+			case 0:
+				time_basis.col(i) << u * u * u, u * u, u, 1;
+				break;
+			case 1:
+				time_basis.col(i) << 3 * u * u * du_dt, 2 * u * du_dt, du_dt, 0;
+				break;
+			case 2:
+				time_basis.col(i) << 6 * u * du_dt * du_dt, 2 * du_dt * du_dt, 0, 0;
+				break;
+			default:
+				assert(false); // unsupported derivative
+				time_basis.col(i).setZero();
+				break;
+			}
+			++i;
+		}
+
+		int group_size = i - group_beg;
+		const auto& coeffs = mSegCoeffs.middleCols(seg * gNumSegCoeffs, gNumSegCoeffs);
+		out_result.middleCols(group_beg, group_size).noalias() = coeffs * time_basis.middleCols(group_beg, group_size);
 	}
 }
 
 double cCurve::GetSegDuration(int seg) const
 {
 	// get the duration of each curve segment
-	// for now, they are assumed to all have the same duration
-	return mSegmentDuration;
+	return mSegTimes[seg + 1] - mSegTimes[seg];
+}
+
+void cCurve::InsertSeg(int seg)
+{
+	// makes room for a new segment at index seg in the per segment tables after an anchor
+	// has been inserted, the new segment has the default duration and its entries still need to be rebuilt
+	int num_segs = std::max(0, GetNumSegments());
+	int dim = GetDim();
+	assert(seg >= 0 && seg < num_segs);
+	assert(static_cast<int>(mSegTimes.size()) == num_segs);
+
+	mSegTimes.insert(mSegTimes.begin() + seg + 1, mSegTimes[seg] + mSegmentDuration);
+	for (size_t i = seg + 2; i < mSegTimes.size(); ++i)
+	{
+		mSegTimes[i] += mSegmentDuration;
+	}
+	BuildSegTimes();
+
+	int num_tail = gNumSegCoeffs * (num_segs - seg - 1);
+	mSegCoeffs.conservativeResize(dim, gNumSegCoeffs * num_segs);
+	mSegCoeffs.rightCols(num_tail) = mSegCoeffs.middleCols(gNumSegCoeffs * seg, num_tail).eval();
+
+	int arc_idx = seg * gArcLengthSteps;
+	mArcLengths.insert(mArcLengths.begin() + arc_idx + 1, gArcLengthSteps, mArcLengths[arc_idx]);
+}
+
+void cCurve::RemoveSeg(int seg)
+{
+	// removes the entries of segment seg from the per segment tables after an anchor has been removed,
+	// the segments that follow are moved back to start where seg started
+	int num_segs = std::max(0, GetNumSegments());
+	int dim = GetDim();
+	assert(seg >= 0 && seg <= num_segs);
+	assert(static_cast<int>(mSegTimes.size()) == num_segs + 2);
+
+	double duration = mSegTimes[seg + 1] - mSegTimes[seg];
+	mSegTimes.erase(mSegTimes.begin() + seg + 1);
+	for (size_t i = seg + 1; i < mSegTimes.size(); ++i)
+	{
+		mSegTimes[i] -= duration;
+	}
+	BuildSegTimes();
+
+	int num_tail = gNumSegCoeffs * (num_segs - seg);
+	mSegCoeffs.middleCols(gNumSegCoeffs * seg, num_tail) = mSegCoeffs.rightCols(num_tail).eval();
+	mSegCoeffs.conservativeResize(dim, gNumSegCoeffs * num_segs);
+
+	// the entries of the removed segment are dropped and the following entries
+	// are shifted back by the length of the removed segment
+	int arc_idx = seg * gArcLengthSteps;
+	double len = mArcLengths[arc_idx + gArcLengthSteps] - mArcLengths[arc_idx];
+	mArcLengths.erase(mArcLengths.begin() + arc_idx + 1, mArcLengths.begin() + arc_idx + gArcLengthSteps + 1);
+	for (size_t i = arc_idx + 1; i < mArcLengths.size(); ++i)
+	{
+		mArcLengths[i] -= len;
+	}
+}
+
+void cCurve::RebuildSegs(int seg_beg, int seg_end)
+{
+	// rebuilds the cached data of segments [seg_beg, seg_end) after an edit,
+	// segment times are expected to already be up to date
+	int num_segs = std::max(0, GetNumSegments());
+	seg_beg = cMathUtil::Clamp(seg_beg, 0, num_segs);
+	seg_end = cMathUtil::Clamp(seg_end, seg_beg, num_segs);
+
+	mSegKernels = &GetSegKernels(mCurveType, GetDim());
+	for (int s = seg_beg; s < seg_end; ++s)
+	{
+		BuildSegCoeffs(s);
+	}
+	BuildArcLengths(seg_beg, seg_end);
+	ComputeAnchorTangents(seg_beg, seg_end);
+}
+
+void cCurve::Rebuild()
+{
+	// rebuilds all cached data of the curve
+	BuildSegTimes();
+	BuildSegCoeffs();
+	BuildArcLengths(0);
+	ComputeAnchorTangents();
+}
+
+bool cCurve::SetSegDurations(const std::vector<double>& durations)
+{
+	// sets the duration of every segment, there should be one duration per segment
+	int num_segs = GetNumSegments();
+	int num_durations = static_cast<int>(durations.size());
+
+	bool succ = num_durations == num_segs;
+	if (!succ)
+	{
+		printf("Segment durations mismatch, expecting %i got %i\n", num_segs, num_durations);
+		assert(false);
+	}
+
+	if (succ)
+	{
+		mSegTimes.resize(num_segs + 1);
+		mSegTimes[0] = 0;
+		for (int i = 0; i < num_segs; ++i)
+		{
+			double duration = durations[i];
+			if (duration <= 0)
+			{
+				printf("Invalid duration %.5f for segment %i\n", duration, i);
+				succ = false;
+				break;
+			}
+			mSegTimes[i + 1] = mSegTimes[i] + duration;
+		}
+	}
+
+	if (succ)
+	{
+		BuildSegTimes();
+	}
+
+	return succ;
+}
+
+void cCurve::BuildSegTimes()
+{
+	// updates the table of segment start times to match the current number of segments
+	// segments without an explicitly specified duration default to mSegmentDuration
+	int num_segs = std::max(0, GetNumSegments());
+	int prev_size = static_cast<int>(mSegTimes.size());
+	mSegTimes.resize(num_segs + 1);
+
+	if (prev_size == 0)
+	{
+		mSegTimes[0] = 0;
+		prev_size = 1;
+	}
+
+	for (int i = prev_size; i <= num_segs; ++i)
+	{
+		mSegTimes[i] = mSegTimes[i - 1] + mSegmentDuration;
+	}
+
+	// check if segment lookups can skip the binary search
+	const double tol = 1e-9;
+	mUniformSegs = true;
+	for (int i = 0; i < num_segs; ++i)
+	{
+		double duration = GetSegDuration(i);
+		if (std::abs(duration - mSegmentDuration) > tol)
+		{
+			mUniformSegs = false;
+			break;
+		}
+	}
 }
@@ -1,12 +1,18 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include "Eigen/Dense"
 #include "Eigen/StdVector"
 #include <json/json.h>
+#include "CurveT.h"
+#include "util/MappedFile.h"
+#include "util/JsonStream.h"
 
 class cCurve
 {
 public:
+	friend class cCurveCursor;
+
 	enum eCurveType
 	{
 		eCurveTypeCatmullRom,
@@ -24,39 +30,117 @@ public:
 		Eigen::VectorXd mTangent;
 	};
 
+	// views of a single anchor column in the anchor matrices
+	typedef Eigen::Map<const Eigen::VectorXd> tConstAnchorView;
+	typedef Eigen::Map<const Eigen::MatrixXd> tConstAnchorMatrix;
+
 	cCurve();
 	virtual ~cCurve();
 
 	virtual bool Load(const std::string& file);
+	virtual bool SaveBinary(const std::string& file) const;
 	virtual void Clear();
+	virtual void SetCurveType(eCurveType curve_type);
+	virtual eCurveType GetCurveType() const;
 	virtual int GetNumAnchors() const;
-	virtual const Eigen::VectorXd& GetAnchorPos(int i) const;
-	virtual const Eigen::VectorXd& GetAnchorTangent(int i) const;
+	virtual tConstAnchorView GetAnchorPos(int i) const;
+	virtual tConstAnchorView GetAnchorTangent(int i) const;
+	virtual tConstAnchorMatrix GetAnchorPositions() const;
+	virtual const Eigen::MatrixXd& GetAnchorTangents() const;
 	virtual int GetNumSegments() const;
+	virtual double GetSegTime(int seg) const;
+	virtual double GetAnchorTime(int i) const;
 	virtual int GetDim() const;
 
 	virtual void Eval(double time, Eigen::VectorXd& out_result) const;
 	virtual void EvalTangent(double time, Eigen::VectorXd& out_result) const;
 	virtual void EvalNormal(double time, Eigen::VectorXd& out_result) const;
+	virtual void EvalFrame(double time, Eigen::VectorXd& out_pos, Eigen::VectorXd& out_tangent, Eigen::VectorXd& out_normal) const;
+	virtual void EvalBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const;
+	virtual void EvalTangentBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const;
+	virtual void EvalNormalBatch(const Eigen::VectorXd& times, Eigen::MatrixXd& out_result) const;
 	virtual double GetMaxTime() const;
 
+	virtual void Tessellate(double max_err, Eigen::MatrixXd& out_pts) const;
+
+	virtual double GetArcLength() const;
+	virtual double CalcArcLength(double time) const;
+	virtual double CalcArcLengthTime(double dist, bool refine = true) const;
+
 	virtual void Add(const tAnchor& anchor);
+	virtual void InsertAnchor(int i, const Eigen::VectorXd& pos);
+	virtual void MoveAnchor(int i, const Eigen::VectorXd& pos);
+	virtual void RemoveAnchor(int i);
 
 protected:
 	
 	static eCurveType ParseCurveType(const std::string& str);
+	static bool IsBinaryFile(const std::string& file);
+	static const tCurveSegKernels& GetSegKernels(eCurveType curve_type, int dim);
 
 	eCurveType mCurveType;
-	double mSegmentDuration; // assume constant duration for each segment
+	const tCurveSegKernels* mSegKernels; // evaluation kernels specialized for the curve type and dimension
+	double mSegmentDuration; // default duration for segments without an explicit duration
+	bool mUniformSegs; // true if every segment has a duration of mSegmentDuration
+
+	// start time of each segment, followed by the end time of the last segment
+	std::vector<double> mSegTimes;
+
+	// anchor positions and tangents, stored as dim x num anchors
+	// so that the anchors of a curve live in a single contiguous allocation
+	Eigen::MatrixXd mAnchorPos;
+	Eigen::MatrixXd mAnchorTangents;
 
-	std::vector<tAnchor, Eigen::aligned_allocator<tAnchor>> mAnchors;
+	// anchor positions loaded from a binary curve file are used directly from the mapped file,
+	// in which case mAnchorPos is unused until the first edit copies the anchors into it
+	std::shared_ptr<cMappedFile> mAnchorFile;
+	const double* mMappedAnchorPos;
+	int mMappedDim;
+	int mMappedNumAnchors;
 
-	virtual bool ParseAnchors(const Json::Value& root);
-	virtual bool ParseAnchor(const Json::Value& root, tAnchor& out_anchor) const;
+	// polynomial coefficients of each segment, stored as dim x (4 * num segments)
+	// columns [4 * seg, 4 * seg + 3] hold the coefficients of u^3, u^2, u, 1
+	Eigen::MatrixXd mSegCoeffs;
+
+	// cumulative arc length of the curve sampled at regular intervals of u within each segment
+	std::vector<double> mArcLengths;
+
+	virtual bool LoadJson(const std::string& file);
+	virtual bool LoadBinary(const std::string& file);
+	virtual void UnmapAnchors();
+
+	virtual bool ParseAnchors(cJsonStream& stream);
+	virtual bool ParseAnchor(cJsonStream& stream, double* out_pos, int max_dim, int& out_dim) const;
+	virtual bool ParseSegDurations(const Json::Value& root);
 	virtual void PrintAnchors() const;
 	virtual void GetAnchors(int seg, int& anchor_beg, int& anchor_end) const;
-	virtual double GetAnchorTime(int i) const;
 	virtual void ComputeAnchorTangents();
+	virtual void ComputeAnchorTangents(int seg_beg, int seg_end);
+	virtual void GetAnchorSegs(int i, int& seg_beg, int& seg_end) const;
+	virtual int GetAnchorSeg(int i) const;
 
 	virtual double GetSegDuration(int seg) const;
+	virtual void BuildSegTimes();
+	virtual bool SetSegDurations(const std::vector<double>& durations);
+	virtual void InsertSeg(int seg);
+	virtual void RemoveSeg(int seg);
+	virtual void RebuildSegs(int seg_beg, int seg_end);
+	virtual void Rebuild();
+
+	virtual void FindSeg(double time, int& out_seg, double& out_u) const;
+	virtual void FindSeg(double time, int seg_hint, int& out_seg, double& out_u) const;
+	virtual void BuildSegCoeffs();
+	virtual void BuildSegCoeffs(int seg);
+	virtual void EvalSeg(int seg, double u, Eigen::VectorXd& out_result) const;
+	virtual void EvalSegTangent(int seg, double u, Eigen::VectorXd& out_result) const;
+	virtual void EvalSegNormal(int seg, double u, Eigen::VectorXd& out_result) const;
+	virtual void EvalBatch(const Eigen::VectorXd& times, int deriv, Eigen::MatrixXd& out_result) const;
+
+	virtual void TessellateSeg(int seg, double u0, const Eigen::VectorXd& p0, double u1, const Eigen::VectorXd& p1,
+								int depth, double max_err, std::vector<double>& out_pts) const;
+
+	virtual void BuildArcLengths(int seg_beg);
+	virtual void BuildArcLengths(int seg_beg, int seg_end);
+	virtual double CalcSegArcLength(int seg, double u0, double u1) const;
+	virtual double CalcSegSpeed(int seg, double u) const;
 };
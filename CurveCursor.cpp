@@ -0,0 +1,132 @@
+#include "CurveCursor.h"
+#include <cmath>
+#include "util/MathUtil.h"
+
+cCurveCursor::cCurveCursor()
+{
+	mCurve = nullptr;
+	mLoop = true;
+	mTime = 0;
+	mSeg = gInvalidIdx;
+	mU = 0;
+}
+
+cCurveCursor::cCurveCursor(const cCurve* curve)
+{
+	mLoop = true;
+	SetCurve(curve);
+}
+
+cCurveCursor::~cCurveCursor()
+{
+}
+
+void cCurveCursor::SetCurve(const cCurve* curve)
+{
+	mCurve = curve;
+	mTime = 0;
+	mSeg = gInvalidIdx;
+	UpdateSeg();
+}
+
+const cCurve* cCurveCursor::GetCurve() const
+{
+	return mCurve;
+}
+
+void cCurveCursor::SetLoop(bool loop)
+{
+	mLoop = loop;
+}
+
+bool cCurveCursor::GetLoop() const
+{
+	return mLoop;
+}
+
+void cCurveCursor::SetTime(double time)
+{
+	mTime = WrapTime(time);
+	UpdateSeg();
+}
+
+void cCurveCursor::Advance(double time_step)
+{
+	SetTime(mTime + time_step);
+}
+
+double cCurveCursor::GetTime() const
+{
+	return mTime;
+}
+
+void cCurveCursor::Eval(Eigen::VectorXd& out_result) const
+{
+	assert(mCurve != nullptr);
+	mCurve->EvalSeg(mSeg, mU, out_result);
+}
+
+void cCurveCursor::EvalTangent(Eigen::VectorXd& out_result) const
+{
+	assert(mCurve != nullptr);
+	mCurve->EvalSegTangent(mSeg, mU, out_result);
+}
+
+void cCurveCursor::EvalNormal(Eigen::VectorXd& out_result) const
+{
+	assert(mCurve != nullptr);
+	mCurve->EvalSegNormal(mSeg, mU, out_result);
+}
+
+void cCurveCursor::EvalFrame(Eigen::VectorXd& out_pos, Eigen::VectorXd& out_tangent, Eigen::VectorXd& out_normal) const
+{
+	assert(mCurve != nullptr);
+	mCurve->EvalSeg(mSeg, mU, out_pos);
+	mCurve->EvalSegTangent(mSeg, mU, out_tangent);
+	mCurve->EvalSegNormal(mSeg, mU, out_normal);
+}
+
+double cCurveCursor::WrapTime(double time) const
+{
+	// looping cursors wrap time into [0, max time), otherwise time is clamped to the curve
+	double max_time = (mCurve != nullptr) ? mCurve->GetMaxTime() : 0;
+	if (max_time <= 0)
+	{
+		time = 0;
+	}
+	else if (mLoop)
+	{
+		// a single subtraction covers regular playback, fmod is only needed for large jumps
+		if (time >= max_time && time < 2 * max_time)
+		{
+			time -= max_time;
+		}
+		else if (time < 0 || time >= max_time)
+		{
+			time = std::fmod(time, max_time);
+			if (time < 0)
+			{
+				time += max_time;
+			}
+		}
+	}
+	else
+	{
+		time = cMathUtil::Clamp(time, 0.0, max_time);
+	}
+	return time;
+}
+
+void cCurveCursor::UpdateSeg()
+{
+	// the previous segment is used as the starting point of the search
+	if (mCurve != nullptr)
+	{
+		mCurve->FindSeg(mTime, mSeg, mSeg, mU);
+	}
+	else
+	{
+		mSeg = gInvalidIdx;
+		mU = 0;
+	}
+}
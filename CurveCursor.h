@@ -0,0 +1,40 @@
+#pragma once
+#include "Curve.h"
+
+// playback position on a curve
+// the cursor remembers the segment of the last lookup and searches from there, so
+// stepping through the curve frame by frame takes amortized constant time per lookup,
+// the curve is only read from, so many cursors can share a single curve
+
+class cCurveCursor
+{
+public:
+	cCurveCursor();
+	cCurveCursor(const cCurve* curve);
+	virtual ~cCurveCursor();
+
+	virtual void SetCurve(const cCurve* curve);
+	virtual const cCurve* GetCurve() const;
+	virtual void SetLoop(bool loop);
+	virtual bool GetLoop() const;
+
+	virtual void SetTime(double time);
+	virtual void Advance(double time_step);
+	virtual double GetTime() const;
+
+	virtual void Eval(Eigen::VectorXd& out_result) const;
+	virtual void EvalTangent(Eigen::VectorXd& out_result) const;
+	virtual void EvalNormal(Eigen::VectorXd& out_result) const;
+	virtual void EvalFrame(Eigen::VectorXd& out_pos, Eigen::VectorXd& out_tangent, Eigen::VectorXd& out_normal) const;
+
+protected:
+	const cCurve* mCurve;
+	bool mLoop; // wrap around at the end of the curve instead of clamping
+
+	double mTime; // time on the curve, in [0, max time]
+	int mSeg;
+	double mU;
+
+	virtual double WrapTime(double time) const;
+	virtual void UpdateSeg();
+};
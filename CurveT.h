@@ -0,0 +1,127 @@
+#pragma once
+#include "Eigen/Dense"
+
+// compile-time specialized kernels for the cubic segments of cCurve
+// the dimension of the anchors and the basis are template parameters so that
+// the kernels of common curves (e.g. 3D paths) can be fully unrolled and do not allocate,
+// Dim can also be Eigen::Dynamic for all other dimensions
+
+// basis matrices for the cubic segments
+// row k holds the weights of the 4 anchors for the coefficient of u^(3 - k)
+constexpr double gCatmullRomBasis[16] = {
+	-0.5,  1.5, -1.5,  0.5,
+	 1.0, -2.5,  2.0, -0.5,
+	-0.5,  0.0,  0.5,  0.0,
+	 0.0,  1.0,  0.0,  0.0
+};
+
+constexpr double gBSplineBasis[16] = {
+	-1.0 / 6,  3.0 / 6, -3.0 / 6, 1.0 / 6,
+	 3.0 / 6, -6.0 / 6,  3.0 / 6, 0.0,
+	-3.0 / 6,  0.0,      3.0 / 6, 0.0,
+	 1.0 / 6,  4.0 / 6,  1.0 / 6, 0.0
+};
+
+struct tCatmullRomBasis
+{
+	static constexpr double Weight(int k, int i) { return gCatmullRomBasis[k * 4 + i]; }
+};
+
+struct tBSplineBasis
+{
+	static constexpr double Weight(int k, int i) { return gBSplineBasis[k * 4 + i]; }
+};
+
+// segment kernels of a particular specialization, used by cCurve to dispatch
+// coefficients are stored as dim x 4 column-major blocks, columns hold the coefficients of u^3, u^2, u, 1
+// results should be 16 byte aligned, as the storage of Eigen::VectorXd is
+struct tCurveSegKernels
+{
+	void(*mBuildSegCoeffs)(const double* const* anchors, int dim, double* out_coeffs);
+	void(*mEvalSeg)(const double* coeffs, int dim, double u, double* out_result);
+	void(*mEvalSegTangent)(const double* coeffs, int dim, double u, double du_dt, double* out_result);
+	void(*mEvalSegNormal)(const double* coeffs, int dim, double u, double du_dt, double* out_result);
+};
+
+template <int Dim, class tBasis>
+class cCurveKernels
+{
+public:
+	static const int gNumSegCoeffs = 4;
+	typedef Eigen::Matrix<double, Dim, 1> tPoint;
+	typedef Eigen::Matrix<double, Dim, gNumSegCoeffs> tSegCoeffs;
+
+	static const tCurveSegKernels gSegKernels;
+
+	static void BuildSegCoeffs(const double* const* anchors, int dim, double* out_coeffs);
+	static void EvalSeg(const double* coeffs, int dim, double u, double* out_result);
+	static void EvalSegTangent(const double* coeffs, int dim, double u, double du_dt, double* out_result);
+	static void EvalSegNormal(const double* coeffs, int dim, double u, double du_dt, double* out_result);
+
+protected:
+	template <class tExpr>
+	static void AssignResult(const tExpr& expr, int dim, double* out_result);
+};
+
+template <int Dim, class tBasis>
+const tCurveSegKernels cCurveKernels<Dim, tBasis>::gSegKernels = {
+	&cCurveKernels<Dim, tBasis>::BuildSegCoeffs,
+	&cCurveKernels<Dim, tBasis>::EvalSeg,
+	&cCurveKernels<Dim, tBasis>::EvalSegTangent,
+	&cCurveKernels<Dim, tBasis>::EvalSegNormal
+};
+
+template <int Dim, class tBasis>
+void cCurveKernels<Dim, tBasis>::BuildSegCoeffs(const double* const* anchors, int dim, double* out_coeffs)
+{
+	// coefficients are the basis matrix times the 4 anchors supporting the segment
+	Eigen::Map<tSegCoeffs> coeffs(out_coeffs, dim, gNumSegCoeffs);
+	coeffs.setZero();
+
+	for (int i = 0; i < gNumSegCoeffs; ++i)
+	{
+		Eigen::Map<const tPoint> pos(anchors[i], dim);
+		for (int k = 0; k < gNumSegCoeffs; ++k)
+		{
+			coeffs.col(k) += tBasis::Weight(k, i) * pos;
+		}
+	}
+}
+
+template <int Dim, class tBasis>
+void cCurveKernels<Dim, tBasis>::EvalSeg(const double* coeffs, int dim, double u, double* out_result)
+{
+	// horner's rule
+	Eigen::Map<const tSegCoeffs> c(coeffs, dim, gNumSegCoeffs);
+	AssignResult(((c.col(0) * u + c.col(1)) * u + c.col(2)) * u + c.col(3), dim, out_result);
+}
+
+template <int Dim, class tBasis>
+void cCurveKernels<Dim, tBasis>::EvalSegTangent(const double* coeffs, int dim, double u, double du_dt, double* out_result)
+{
+	Eigen::Map<const tSegCoeffs> c(coeffs, dim, gNumSegCoeffs);
+	AssignResult((((3 * u) * c.col(0) + 2 * c.col(1)) * u + c.col(2)) * du_dt, dim, out_result);
+}
+
+template <int Dim, class tBasis>
+void cCurveKernels<Dim, tBasis>::EvalSegNormal(const double* coeffs, int dim, double u, double du_dt, double* out_result)
+{
+	Eigen::Map<const tSegCoeffs> c(coeffs, dim, gNumSegCoeffs);
+	AssignResult(((6 * u) * c.col(0) + 2 * c.col(1)) * (du_dt * du_dt), dim, out_result);
+}
+
+template <int Dim, class tBasis>
+template <class tExpr>
+void cCurveKernels<Dim, tBasis>::AssignResult(const tExpr& expr, int dim, double* out_result)
+{
+	// Eigen only vectorizes dynamically sized assignments when the destination is known
+	// to be aligned, so the dynamic kernels expect results stored in heap allocated vectors
+	if (Dim == Eigen::Dynamic)
+	{
+		Eigen::Map<tPoint, Eigen::Aligned>(out_result, dim) = expr;
+	}
+	else
+	{
+		Eigen::Map<tPoint>(out_result, dim) = expr;
+	}
+}
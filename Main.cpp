@@ -77,6 +77,7 @@ int main(int argc, char ** argv) {
 		nanogui::init();
 		{
 			nanogui::ref<cApp> app = new cApp(gWinWidth, gWinHeight, gWinTitle);
+			app->ParseArgs(argc, argv);
 			app->Init();
 
 			app->drawAll();
@@ -0,0 +1,214 @@
+#include "PoseCache.h"
+#include <map>
+#include <tuple>
+#include <iterator>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+#include "util/MathUtil.h"
+
+const int gBakeChunkSize = 256;
+
+std::shared_ptr<const cPoseCache> cPoseCache::Load(const std::string& file, double frame_rate,
+													size_t mem_budget, cThreadPool* pool)
+{
+	return LoadShared(file, nullptr, frame_rate, mem_budget, pool);
+}
+
+std::shared_ptr<const cPoseCache> cPoseCache::Load(const std::string& file, const cCurve& curve, double frame_rate,
+													size_t mem_budget, cThreadPool* pool)
+{
+	return LoadShared(file, &curve, frame_rate, mem_budget, pool);
+}
+
+std::shared_ptr<const cPoseCache> cPoseCache::LoadShared(const std::string& file, const cCurve* curve, double frame_rate,
+														size_t mem_budget, cThreadPool* pool)
+{
+	// caches are only kept alive by their users, the registry just hands out the ones still in use
+	// the budget is part of the key since it can lower the rate the cache is baked at
+	static std::mutex registry_mutex;
+	static std::map<std::tuple<std::string, double, size_t>, std::weak_ptr<const cPoseCache>> registry;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	// entries of caches that are no longer used are dropped, so the registry only grows with the caches in use
+	for (auto it = registry.begin(); it != registry.end();)
+	{
+		it = (it->second.expired()) ? registry.erase(it) : std::next(it);
+	}
+
+	auto key = std::make_tuple(file, frame_rate, mem_budget);
+	auto entry = registry.find(key);
+	std::shared_ptr<const cPoseCache> cache = (entry != registry.end()) ? entry->second.lock() : nullptr;
+	if (cache == nullptr)
+	{
+		cCurve file_curve;
+		bool succ = true;
+		if (curve == nullptr)
+		{
+			succ = file_curve.Load(file);
+			curve = &file_curve;
+		}
+
+		if (succ)
+		{
+			std::shared_ptr<cPoseCache> new_cache = std::shared_ptr<cPoseCache>(new cPoseCache());
+			succ = new_cache->Bake(*curve, frame_rate, mem_budget, pool);
+			if (succ)
+			{
+				cache = new_cache;
+				registry[key] = cache;
+			}
+		}
+
+		if (!succ)
+		{
+			printf("Failed to build pose cache for %s\n", file.c_str());
+		}
+	}
+	return cache;
+}
+
+cPoseCache::cPoseCache()
+{
+	mLoop = true;
+	Clear();
+}
+
+cPoseCache::~cPoseCache()
+{
+}
+
+bool cPoseCache::Bake(const cCurve& curve, double frame_rate, size_t mem_budget, cThreadPool* pool)
+{
+	Clear();
+
+	int dim = curve.GetDim();
+	double max_time = curve.GetMaxTime();
+	bool succ = dim > 0 && curve.GetNumSegments() > 0 && frame_rate > 0;
+	if (!succ)
+	{
+		printf("Unable to bake an empty curve into a pose cache\n");
+		return false;
+	}
+
+	size_t frame_size = dim * sizeof(float);
+	size_t max_frames = mem_budget / frame_size;
+	if (max_frames < 2)
+	{
+		printf("Pose cache budget of %zu bytes is too small for poses with %i dimensions\n", mem_budget, dim);
+		return false;
+	}
+
+	// frames are spread evenly over the clip, so the first and last frame land exactly on the ends
+	double num_intervals = std::max(1.0, std::ceil(max_time * frame_rate));
+	if (num_intervals + 1 > max_frames)
+	{
+		num_intervals = static_cast<double>(max_frames - 1);
+		printf("Pose cache lowered to %.2f frames per second to stay within %zu bytes\n",
+				num_intervals / max_time, mem_budget);
+	}
+
+	int num_frames = static_cast<int>(num_intervals) + 1;
+	mMaxTime = max_time;
+	mFrameRate = (max_time > 0) ? num_intervals / max_time : frame_rate;
+	mFrames.resize(dim, num_frames);
+
+	auto bake_frames = [&](int beg, int end)
+	{
+		Eigen::VectorXd times(end - beg);
+		for (int f = beg; f < end; ++f)
+		{
+			times[f - beg] = std::min(f / mFrameRate, max_time);
+		}
+
+		Eigen::MatrixXd poses;
+		curve.EvalBatch(times, poses);
+		mFrames.block(0, beg, dim, end - beg) = poses.cast<float>();
+	};
+
+	if (pool != nullptr)
+	{
+		pool->ParallelFor(num_frames, gBakeChunkSize, bake_frames);
+	}
+	else
+	{
+		bake_frames(0, num_frames);
+	}
+	return succ;
+}
+
+void cPoseCache::Clear()
+{
+	mFrameRate = 0;
+	mMaxTime = 0;
+	mFrames.resize(0, 0);
+}
+
+void cPoseCache::SetLoop(bool loop)
+{
+	mLoop = loop;
+}
+
+bool cPoseCache::GetLoop() const
+{
+	return mLoop;
+}
+
+int cPoseCache::GetDim() const
+{
+	return static_cast<int>(mFrames.rows());
+}
+
+int cPoseCache::GetNumFrames() const
+{
+	return static_cast<int>(mFrames.cols());
+}
+
+double cPoseCache::GetFrameRate() const
+{
+	return mFrameRate;
+}
+
+double cPoseCache::GetMaxTime() const
+{
+	return mMaxTime;
+}
+
+size_t cPoseCache::GetMemSize() const
+{
+	return mFrames.size() * sizeof(float);
+}
+
+void cPoseCache::Eval(double time, Eigen::VectorXd& out_pose) const
+{
+	assert(GetNumFrames() > 1);
+	int frame = 0;
+	float u = 0;
+	FindFrame(time, frame, u);
+
+	int dim = GetDim();
+	out_pose.resize(dim);
+	const float* frame0 = mFrames.data() + frame * dim;
+	const float* frame1 = frame0 + dim;
+	for (int i = 0; i < dim; ++i)
+	{
+		out_pose[i] = frame0[i] + u * (frame1[i] - frame0[i]);
+	}
+}
+
+void cPoseCache::FindFrame(double time, int& out_frame, float& out_u) const
+{
+	// finds the frame before time, and how far time is towards the next frame
+	if (mLoop && mMaxTime > 0 && (time < 0 || time >= mMaxTime))
+	{
+		time = std::fmod(time, mMaxTime);
+		time = (time < 0) ? time + mMaxTime : time;
+	}
+
+	int num_frames = GetNumFrames();
+	double frame_time = cMathUtil::Clamp(time * mFrameRate, 0.0, static_cast<double>(num_frames - 1));
+	int frame = std::min(static_cast<int>(frame_time), num_frames - 2);
+	out_frame = frame;
+	out_u = static_cast<float>(frame_time - frame);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "Curve.h"
+#include "util/ThreadPool.h"
+
+// poses of a curve baked into a table of frames sampled at a fixed rate and stored as floats,
+// playback is an index computation and a linear blend of two neighbouring frames
+// the table is read only once it is baked, so characters playing the same clip can share a cache
+
+class cPoseCache
+{
+public:
+	// returns the cache for a curve file, the cache is shared by every caller that requests
+	// the same file at the same rate and budget for as long as one of them holds on to it
+	static std::shared_ptr<const cPoseCache> Load(const std::string& file, double frame_rate = 120,
+												size_t mem_budget = 64 << 20, cThreadPool* pool = nullptr);
+	// same as above for a curve that was already loaded from file, the file is only used to look up the cache
+	static std::shared_ptr<const cPoseCache> Load(const std::string& file, const cCurve& curve, double frame_rate = 120,
+												size_t mem_budget = 64 << 20, cThreadPool* pool = nullptr);
+
+	cPoseCache();
+	virtual ~cPoseCache();
+
+	// the frame rate is lowered if the table does not fit into mem_budget bytes at the requested rate,
+	// frames are evaluated in parallel if a thread pool is provided
+	virtual bool Bake(const cCurve& curve, double frame_rate = 120, size_t mem_budget = 64 << 20,
+					cThreadPool* pool = nullptr);
+	virtual void Clear();
+
+	virtual void SetLoop(bool loop);
+	virtual bool GetLoop() const;
+
+	virtual int GetDim() const;
+	virtual int GetNumFrames() const;
+	virtual double GetFrameRate() const;
+	virtual double GetMaxTime() const;
+	virtual size_t GetMemSize() const;
+
+	virtual void Eval(double time, Eigen::VectorXd& out_pose) const;
+
+protected:
+	bool mLoop; // wrap around at the end of the clip instead of holding the last frame
+	double mFrameRate;
+	double mMaxTime;
+
+	// baked poses, stored as dim x num frames
+	Eigen::MatrixXf mFrames;
+
+	virtual void FindFrame(double time, int& out_frame, float& out_u) const;
+
+	// curve can be null, in which case it is loaded from file if the cache has to be baked
+	static std::shared_ptr<const cPoseCache> LoadShared(const std::string& file, const cCurve* curve, double frame_rate,
+														size_t mem_budget, cThreadPool* pool);
+};
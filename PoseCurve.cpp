@@ -0,0 +1,278 @@
+#include "PoseCurve.h"
+#include <algorithm>
+
+const double gUniformKeyTol = 1e-9;
+const double gQuatLogEps = 1e-12;
+
+cPoseCurve::cPoseCurve()
+{
+	mRotInterp = eRotInterpNlerp;
+	Clear();
+}
+
+cPoseCurve::~cPoseCurve()
+{
+}
+
+bool cPoseCurve::Init(const cCurve& curve, const cArticulatedFigure& figure)
+{
+	Clear();
+
+	int num_keys = curve.GetNumAnchors();
+	bool succ = curve.GetDim() == figure.GetNumDOFs() && num_keys > 1;
+	if (!succ)
+	{
+		printf("Pose curve with %i dimensions and %i anchors does not match a figure with %i DOFs\n",
+				curve.GetDim(), num_keys, figure.GetNumDOFs());
+		return false;
+	}
+
+	// every anchor becomes a key at the time that the curve passes through the anchor,
+	// the keys are converted straight from the anchor poses, so none of the Euler angle
+	// interpolation of the curve ends up in the keys
+	mNumJoints = figure.GetNumJoints();
+	mKeyTimes.resize(num_keys);
+	mRootPos.resize(3, num_keys);
+	mKeyRots.resize(num_keys * mNumJoints);
+
+	Eigen::VectorXd pose;
+	cArticulatedFigure::tQuatPose quat_pose;
+	for (int k = 0; k < num_keys; ++k)
+	{
+		pose = curve.GetAnchorPos(k);
+		figure.BuildQuatPose(pose, quat_pose);
+
+		mKeyTimes[k] = curve.GetAnchorTime(k);
+		mRootPos.col(k) = quat_pose.mRootPos.segment(0, 3);
+		for (int j = 0; j < mNumJoints; ++j)
+		{
+			tQuaternion q = quat_pose.mJointRots[j];
+			if (k > 0 && q.dot(mKeyRots[(k - 1) * mNumJoints + j]) < 0)
+			{
+				q.coeffs() = -q.coeffs();
+			}
+			mKeyRots[k * mNumJoints + j] = q;
+		}
+	}
+
+	int num_intervals = num_keys - 1;
+	mKeyDuration = (mKeyTimes.back() - mKeyTimes.front()) / num_intervals;
+	mUniformKeys = mKeyTimes.front() == 0;
+	for (int k = 0; k < num_keys && mUniformKeys; ++k)
+	{
+		mUniformKeys = std::abs(mKeyTimes[k] - k * mKeyDuration) < gUniformKeyTol;
+	}
+
+	BuildRootTangents();
+	BuildSquadCtrls();
+	return succ;
+}
+
+void cPoseCurve::Clear()
+{
+	mNumJoints = 0;
+	mUniformKeys = false;
+	mKeyDuration = 0;
+	mKeyTimes.clear();
+	mRootPos.resize(3, 0);
+	mRootTangents.resize(3, 0);
+	mKeyRots.clear();
+	mSquadCtrls.clear();
+}
+
+void cPoseCurve::SetRotInterp(eRotInterp interp)
+{
+	mRotInterp = interp;
+}
+
+cPoseCurve::eRotInterp cPoseCurve::GetRotInterp() const
+{
+	return mRotInterp;
+}
+
+int cPoseCurve::GetNumKeys() const
+{
+	return static_cast<int>(mKeyTimes.size());
+}
+
+int cPoseCurve::GetNumJoints() const
+{
+	return mNumJoints;
+}
+
+double cPoseCurve::GetMaxTime() const
+{
+	return (mKeyTimes.empty()) ? 0 : mKeyTimes.back();
+}
+
+void cPoseCurve::Eval(double time, cArticulatedFigure::tQuatPose& out_pose) const
+{
+	assert(GetNumKeys() > 1);
+	int key = 0;
+	double u = 0;
+	FindKey(time, key, u);
+
+	out_pose.mRootPos = EvalRootPos(key, u);
+	out_pose.mJointRots.resize(mNumJoints);
+
+	const tQuaternion* rots0 = &mKeyRots[key * mNumJoints];
+	const tQuaternion* rots1 = rots0 + mNumJoints;
+	switch (mRotInterp)
+	{
+	case eRotInterpNlerp:
+		for (int j = 0; j < mNumJoints; ++j)
+		{
+			out_pose.mJointRots[j] = Nlerp(rots0[j], rots1[j], u);
+		}
+		break;
+	case eRotInterpSquad:
+	{
+		const tQuaternion* ctrls0 = &mSquadCtrls[key * mNumJoints];
+		const tQuaternion* ctrls1 = ctrls0 + mNumJoints;
+		for (int j = 0; j < mNumJoints; ++j)
+		{
+			out_pose.mJointRots[j] = Squad(rots0[j], rots1[j], ctrls0[j], ctrls1[j], u);
+		}
+		break;
+	}
+	default:
+		assert(false); // unsupported interpolation
+		break;
+	}
+}
+
+void cPoseCurve::BuildRootTangents()
+{
+	// Catmull-Rom tangents, with one sided differences at the first and last key
+	int num_keys = GetNumKeys();
+	mRootTangents.resize(3, num_keys);
+	for (int k = 0; k < num_keys; ++k)
+	{
+		int prev = std::max(k - 1, 0);
+		int next = std::min(k + 1, num_keys - 1);
+		double dt = mKeyTimes[next] - mKeyTimes[prev];
+		if (dt > 0)
+		{
+			mRootTangents.col(k) = (mRootPos.col(next) - mRootPos.col(prev)) / dt;
+		}
+		else
+		{
+			mRootTangents.col(k).setZero();
+		}
+	}
+}
+
+void cPoseCurve::BuildSquadCtrls()
+{
+	// s_i = q_i * exp(-(log(q_i^-1 * q_i+1) + log(q_i^-1 * q_i-1)) / 4),
+	// the first and last keys use their own rotation as the control point
+	int num_keys = GetNumKeys();
+	mSquadCtrls = mKeyRots;
+	for (int k = 1; k < num_keys - 1; ++k)
+	{
+		for (int j = 0; j < mNumJoints; ++j)
+		{
+			const tQuaternion& q = mKeyRots[k * mNumJoints + j];
+			const tQuaternion& q_prev = mKeyRots[(k - 1) * mNumJoints + j];
+			const tQuaternion& q_next = mKeyRots[(k + 1) * mNumJoints + j];
+			tQuaternion q_inv = q.conjugate();
+
+			tQuaternion log_sum;
+			log_sum.coeffs() = QuatLog(q_inv * q_next).coeffs() + QuatLog(q_inv * q_prev).coeffs();
+			log_sum.coeffs() *= -0.25;
+			mSquadCtrls[k * mNumJoints + j] = (q * QuatExp(log_sum)).normalized();
+		}
+	}
+}
+
+void cPoseCurve::FindKey(double time, int& out_key, double& out_u) const
+{
+	// finds the key that starts the interval containing time, and the normalized time within that interval
+	int num_keys = GetNumKeys();
+	time = cMathUtil::Clamp(time, mKeyTimes.front(), mKeyTimes.back());
+
+	int key = 0;
+	if (mUniformKeys)
+	{
+		key = static_cast<int>(time / mKeyDuration);
+	}
+	else
+	{
+		auto key_end = std::upper_bound(mKeyTimes.begin(), mKeyTimes.end(), time);
+		key = static_cast<int>(key_end - mKeyTimes.begin()) - 1;
+	}
+	key = cMathUtil::Clamp(key, 0, num_keys - 2);
+
+	double duration = mKeyTimes[key + 1] - mKeyTimes[key];
+	out_key = key;
+	out_u = (duration > 0) ? (time - mKeyTimes[key]) / duration : 0;
+	out_u = cMathUtil::Clamp(out_u, 0.0, 1.0);
+}
+
+tVector cPoseCurve::EvalRootPos(int key, double u) const
+{
+	// cubic Hermite interpolation between two keys
+	double duration = mKeyTimes[key + 1] - mKeyTimes[key];
+	double u2 = u * u;
+	double u3 = u2 * u;
+	double h00 = 2 * u3 - 3 * u2 + 1;
+	double h10 = u3 - 2 * u2 + u;
+	double h01 = -2 * u3 + 3 * u2;
+	double h11 = u3 - u2;
+
+	Eigen::Vector3d pos = h00 * mRootPos.col(key) + (h10 * duration) * mRootTangents.col(key)
+						+ h01 * mRootPos.col(key + 1) + (h11 * duration) * mRootTangents.col(key + 1);
+	return tVector(pos[0], pos[1], pos[2], 0);
+}
+
+tQuaternion cPoseCurve::Nlerp(const tQuaternion& q0, const tQuaternion& q1, double u)
+{
+	// the keys already lie in the same hemisphere, so no sign flip is needed
+	tQuaternion q;
+	q.coeffs() = (1 - u) * q0.coeffs() + u * q1.coeffs();
+	q.normalize();
+	return q;
+}
+
+tQuaternion cPoseCurve::Squad(const tQuaternion& q0, const tQuaternion& q1,
+							const tQuaternion& s0, const tQuaternion& s1, double u)
+{
+	tQuaternion q = q0.slerp(u, q1);
+	tQuaternion s = s0.slerp(u, s1);
+	return q.slerp(2 * u * (1 - u), s);
+}
+
+tQuaternion cPoseCurve::QuatLog(const tQuaternion& q)
+{
+	// log of a unit quaternion, a pure quaternion holding the half angle times the axis
+	double vec_norm = q.vec().norm();
+	tQuaternion result;
+	result.w() = 0;
+	if (vec_norm > gQuatLogEps)
+	{
+		double theta = std::atan2(vec_norm, q.w());
+		result.vec() = q.vec() * (theta / vec_norm);
+	}
+	else
+	{
+		result.vec().setZero();
+	}
+	return result;
+}
+
+tQuaternion cPoseCurve::QuatExp(const tQuaternion& q)
+{
+	// exp of a pure quaternion
+	double theta = q.vec().norm();
+	tQuaternion result;
+	result.w() = std::cos(theta);
+	if (theta > gQuatLogEps)
+	{
+		result.vec() = q.vec() * (std::sin(theta) / theta);
+	}
+	else
+	{
+		result.vec() = q.vec();
+	}
+	return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "Curve.h"
+#include "ArticulatedFigure.h"
+
+// keyframed poses of an articulated figure with the joint rotations stored as unit quaternions
+// there is one key for every anchor of a curve of Euler angle poses, converted once when the curve is built,
+// rotations are blended between keys with normalized lerp or squad instead of interpolating the Euler angles,
+// while the root position follows a cubic Catmull-Rom spline through the keys
+
+class cPoseCurve
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	enum eRotInterp
+	{
+		eRotInterpNlerp,
+		eRotInterpSquad,
+		eRotInterpMax
+	};
+
+	cPoseCurve();
+	virtual ~cPoseCurve();
+
+	virtual bool Init(const cCurve& curve, const cArticulatedFigure& figure);
+	virtual void Clear();
+
+	virtual void SetRotInterp(eRotInterp interp);
+	virtual eRotInterp GetRotInterp() const;
+	virtual int GetNumKeys() const;
+	virtual int GetNumJoints() const;
+	virtual double GetMaxTime() const;
+
+	// time is clamped to [0, max time]
+	virtual void Eval(double time, cArticulatedFigure::tQuatPose& out_pose) const;
+
+protected:
+	typedef std::vector<tQuaternion, Eigen::aligned_allocator<tQuaternion>> tQuatArr;
+
+	eRotInterp mRotInterp;
+	int mNumJoints;
+	bool mUniformKeys; // true if the keys are evenly spaced by mKeyDuration
+	double mKeyDuration;
+	std::vector<double> mKeyTimes;
+
+	// root position and tangent wrt time at each key, stored as 3 x num keys
+	Eigen::MatrixXd mRootPos;
+	Eigen::MatrixXd mRootTangents;
+
+	// rotations of every joint at each key, the rotations of key i start at i * num joints,
+	// neighbouring keys of a joint lie in the same hemisphere so blending takes the short way around
+	tQuatArr mKeyRots;
+	// inner control points for squad, stored in the same layout as mKeyRots
+	tQuatArr mSquadCtrls;
+
+	virtual void BuildRootTangents();
+	virtual void BuildSquadCtrls();
+	virtual void FindKey(double time, int& out_key, double& out_u) const;
+	virtual tVector EvalRootPos(int key, double u) const;
+
+	static tQuaternion Nlerp(const tQuaternion& q0, const tQuaternion& q1, double u);
+	static tQuaternion Squad(const tQuaternion& q0, const tQuaternion& q1,
+							const tQuaternion& s0, const tQuaternion& s1, double u);
+	static tQuaternion QuatLog(const tQuaternion& q);
+	static tQuaternion QuatExp(const tQuaternion& q);
+};
@@ -0,0 +1,173 @@
+#include "bench/Bench.h"
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include "Eigen/Dense"
+
+const double gDefaultMinTime = 0.05;
+const int gDefaultNumReps = 5;
+const int gMaxIters = 1 << 30;
+
+// accumulates values passed to Sink, volatile so that the stores cannot be elided
+volatile double gBenchSink = 0;
+
+cBench::cBench()
+{
+	mMinTime = gDefaultMinTime;
+	mNumReps = gDefaultNumReps;
+	mNotes = Json::Value(Json::objectValue);
+}
+
+cBench::~cBench()
+{
+}
+
+void cBench::SetMinTime(double min_time)
+{
+	mMinTime = min_time;
+}
+
+void cBench::SetNumReps(int num_reps)
+{
+	mNumReps = std::max(1, num_reps);
+}
+
+void cBench::SetFilter(const std::string& filter)
+{
+	mFilter = filter;
+}
+
+bool cBench::Run(const std::string& name, const Json::Value& params, const tBenchFunc& func)
+{
+	// benchmarks that do not match the filter are skipped
+	if (!MatchFilter(name))
+	{
+		return false;
+	}
+
+	// calibrate the number of iterations until a repetition takes at least the minimum time,
+	// this also serves as the warm up for caches and lazily initialized data
+	int num_iters = 1;
+	double elapsed = TimeIters(func, num_iters);
+	while (elapsed < mMinTime && num_iters < gMaxIters)
+	{
+		double scale = (elapsed > 0) ? (1.2 * mMinTime / elapsed) : 10;
+		scale = std::min(std::max(scale, 2.0), 10.0);
+		num_iters = static_cast<int>(std::min(num_iters * scale, static_cast<double>(gMaxIters)));
+		elapsed = TimeIters(func, num_iters);
+	}
+
+	std::vector<double> rep_ns(mNumReps);
+	for (int r = 0; r < mNumReps; ++r)
+	{
+		rep_ns[r] = TimeIters(func, num_iters) * 1e9 / num_iters;
+	}
+	std::sort(rep_ns.begin(), rep_ns.end());
+
+	tResult result;
+	result.mName = name;
+	result.mParams = params;
+	result.mIters = num_iters;
+	result.mReps = mNumReps;
+	result.mMinNs = rep_ns[0];
+	result.mMedianNs = rep_ns[mNumReps / 2];
+	result.mMeanNs = 0;
+	for (int r = 0; r < mNumReps; ++r)
+	{
+		result.mMeanNs += rep_ns[r] / mNumReps;
+	}
+	mResults.push_back(result);
+
+	printf("%-48s %12.1f ns/op  (%i iters x %i reps)\n", name.c_str(), result.mMedianNs, num_iters, mNumReps);
+	return true;
+}
+
+void cBench::AddNote(const std::string& name, const std::string& note)
+{
+	// notes record benchmarks that could not be run, e.g. for lack of an OpenGL context
+	printf("%-48s skipped: %s\n", name.c_str(), note.c_str());
+	mNotes[name] = note;
+}
+
+const std::vector<cBench::tResult>& cBench::GetResults() const
+{
+	return mResults;
+}
+
+bool cBench::WriteJson(const std::string& file) const
+{
+	Json::Value root;
+
+	Json::Value& context = root["Context"];
+#if defined(NDEBUG)
+	context["Build"] = "Release";
+#else
+	context["Build"] = "Debug";
+#endif
+	context["SIMD"] = Eigen::SimdInstructionSetsInUse();
+	context["MinTime"] = mMinTime;
+	context["Reps"] = mNumReps;
+
+	Json::Value& benchmarks = root["Benchmarks"];
+	benchmarks = Json::Value(Json::arrayValue);
+	for (size_t i = 0; i < mResults.size(); ++i)
+	{
+		const tResult& result = mResults[i];
+		Json::Value entry;
+		entry["Name"] = result.mName;
+		entry["Params"] = result.mParams;
+		entry["Iters"] = result.mIters;
+		entry["Reps"] = result.mReps;
+		entry["MinNs"] = result.mMinNs;
+		entry["MedianNs"] = result.mMedianNs;
+		entry["MeanNs"] = result.mMeanNs;
+		benchmarks.append(entry);
+	}
+
+	if (!mNotes.empty())
+	{
+		root["Skipped"] = mNotes;
+	}
+
+	Json::StyledWriter writer;
+	std::string json = writer.write(root);
+
+	bool succ = true;
+	if (file == "-")
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream f_stream(file.c_str());
+		f_stream << json;
+		succ = f_stream.good();
+		f_stream.close();
+
+		if (!succ)
+		{
+			printf("Failed to write benchmark results to %s\n", file.c_str());
+		}
+	}
+	return succ;
+}
+
+void cBench::Sink(double val)
+{
+	gBenchSink = gBenchSink + val;
+}
+
+bool cBench::MatchFilter(const std::string& name) const
+{
+	return mFilter.empty() || (name.find(mFilter) != std::string::npos);
+}
+
+double cBench::TimeIters(const tBenchFunc& func, int num_iters) const
+{
+	auto beg = std::chrono::steady_clock::now();
+	func(num_iters);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - beg).count();
+}
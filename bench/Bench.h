@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <json/json.h>
+
+// minimal micro-benchmark harness
+// each benchmark is a function that performs an operation a given number of times,
+// the number of iterations is calibrated so that every repetition runs for at least
+// the minimum time, and the per operation timings are reported as JSON
+
+class cBench
+{
+public:
+	// runs the benchmarked operation num_iters times
+	typedef std::function<void(int num_iters)> tBenchFunc;
+
+	struct tResult
+	{
+		std::string mName;
+		Json::Value mParams;
+		int mIters;
+		int mReps;
+		double mMinNs;
+		double mMedianNs;
+		double mMeanNs;
+	};
+
+	cBench();
+	virtual ~cBench();
+
+	virtual void SetMinTime(double min_time);
+	virtual void SetNumReps(int num_reps);
+	virtual void SetFilter(const std::string& filter);
+
+	virtual bool Run(const std::string& name, const Json::Value& params, const tBenchFunc& func);
+	virtual void AddNote(const std::string& name, const std::string& note);
+
+	virtual const std::vector<tResult>& GetResults() const;
+	virtual bool WriteJson(const std::string& file) const;
+
+	// prevents the compiler from discarding the results of benchmarked operations
+	static void Sink(double val);
+
+protected:
+	double mMinTime; // minimum duration of each repetition in seconds
+	int mNumReps;
+	std::string mFilter;
+
+	std::vector<tResult> mResults;
+	Json::Value mNotes;
+
+	virtual bool MatchFilter(const std::string& name) const;
+	virtual double TimeIters(const tBenchFunc& func, int num_iters) const;
+};
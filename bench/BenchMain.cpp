@@ -0,0 +1,625 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <nanogui/nanogui.h>
+
+#include "bench/Bench.h"
+#include "Curve.h"
+#include "ArticulatedFigure.h"
+#include "PoseCurve.h"
+#include "PoseCache.h"
+#include "render/OBJParser.h"
+#include "util/MathUtil.h"
+
+// micro-benchmarks for the hot paths of the curve, kinematics and mesh code
+// usage: cpsc426Bench [-o results.json] [-filter substring] [-min_time seconds] [-reps n]
+// results are printed as they complete and written to a JSON file, "-o -" writes to stdout
+
+const std::string gDefaultOutputFile = "bench_results.json";
+const std::string gMeshFile = "data/meshes/humming_bird.obj";
+const std::string gClipFile = "data/char_params/biped_walk.txt";
+const int gNumSamples = 1024; // number of precomputed inputs cycled through by each benchmark
+const int gSampleMask = gNumSamples - 1;
+const int gNumCurveEdits = 300;
+const int gNumCurveAdds = 8;
+const double gCurveEditTol = 1e-9; // relative to the magnitude of the compared values
+const unsigned int gCurveEditSeed = 426;
+
+// exposes the cached data of a curve so that incremental edits can be compared with a full rebuild
+class cBenchCurve : public cCurve
+{
+public:
+	const Eigen::MatrixXd& GetSegCoeffs() const { return mSegCoeffs; }
+	const std::vector<double>& GetArcLengths() const { return mArcLengths; }
+	void RebuildAll() { Rebuild(); }
+};
+
+void BuildCurve(cCurve::eCurveType curve_type, int dim, int num_anchors, cCurve& out_curve)
+{
+	out_curve.Clear();
+	for (int i = 0; i < num_anchors; ++i)
+	{
+		cCurve::tAnchor anchor;
+		anchor.mPos = Eigen::VectorXd::Random(dim);
+		out_curve.Add(anchor);
+	}
+	out_curve.SetCurveType(curve_type);
+}
+
+bool MatchesRebuild(const cBenchCurve& curve, const cBenchCurve& rebuilt, std::string& out_err)
+{
+	const Eigen::MatrixXd& coeffs = curve.GetSegCoeffs();
+	const Eigen::MatrixXd& rebuilt_coeffs = rebuilt.GetSegCoeffs();
+	const Eigen::MatrixXd& tangents = curve.GetAnchorTangents();
+	const Eigen::MatrixXd& rebuilt_tangents = rebuilt.GetAnchorTangents();
+	const std::vector<double>& lens = curve.GetArcLengths();
+	const std::vector<double>& rebuilt_lens = rebuilt.GetArcLengths();
+
+	out_err.clear();
+	if (coeffs.rows() != rebuilt_coeffs.rows() || coeffs.cols() != rebuilt_coeffs.cols())
+	{
+		out_err = "segment coefficients have a different size";
+	}
+	else if (coeffs.size() > 0
+		&& (coeffs - rebuilt_coeffs).cwiseAbs().maxCoeff() > gCurveEditTol * (1 + rebuilt_coeffs.cwiseAbs().maxCoeff()))
+	{
+		out_err = "segment coefficients differ";
+	}
+	else if (tangents.cols() != rebuilt_tangents.cols()
+		|| (tangents.size() > 0
+		&& (tangents - rebuilt_tangents).cwiseAbs().maxCoeff() > gCurveEditTol * (1 + rebuilt_tangents.cwiseAbs().maxCoeff())))
+	{
+		out_err = "anchor tangents differ";
+	}
+	else if (lens.size() != rebuilt_lens.size())
+	{
+		out_err = "arc length tables have a different size";
+	}
+	else
+	{
+		double len_tol = gCurveEditTol * (1 + rebuilt.GetArcLength());
+		for (size_t i = 0; i < lens.size() && out_err.empty(); ++i)
+		{
+			if (std::abs(lens[i] - rebuilt_lens[i]) > len_tol)
+			{
+				out_err = "arc length tables differ at entry " + std::to_string(i);
+			}
+		}
+	}
+
+	for (int s = 0; s <= curve.GetNumSegments() && out_err.empty(); ++s)
+	{
+		if (std::abs(curve.GetSegTime(s) - rebuilt.GetSegTime(s)) > gCurveEditTol * (1 + rebuilt.GetMaxTime()))
+		{
+			out_err = "segment times differ at segment " + std::to_string(s);
+		}
+	}
+	return out_err.empty();
+}
+
+bool CheckCurveEdits()
+{
+	// anchors are inserted, moved and removed in place, after every edit the cached data
+	// that the edit patched is compared with the data of a copy of the curve rebuilt from scratch,
+	// each curve then has anchors appended with Add and is finally emptied one anchor at a time
+	const cCurve::eCurveType curve_types[] = { cCurve::eCurveTypeCatmullRom, cCurve::eCurveTypeBSpline };
+	const char* curve_type_names[] = { "catmull_rom", "b_spline" };
+	const int dim = 3;
+	const int num_anchors = 16;
+
+	std::mt19937 rand_gen(gCurveEditSeed);
+	bool succ = true;
+	for (int t = 0; t < 2 && succ; ++t)
+	{
+		cBenchCurve curve;
+		BuildCurve(curve_types[t], dim, num_anchors, curve);
+
+		auto matches_rebuild = [&](const std::string& edit_name)
+		{
+			cBenchCurve rebuilt(curve);
+			rebuilt.RebuildAll();
+
+			std::string err;
+			bool match = MatchesRebuild(curve, rebuilt, err);
+			if (!match)
+			{
+				printf("Curve edit check failed for %s after %s with %i anchors: %s\n",
+						curve_type_names[t], edit_name.c_str(), curve.GetNumAnchors(), err.c_str());
+			}
+			return match;
+		};
+
+		for (int e = 0; e < gNumCurveEdits && succ; ++e)
+		{
+			int curr_num_anchors = curve.GetNumAnchors();
+			int edit = e % 3;
+			if (edit == 0 || curr_num_anchors <= 1)
+			{
+				int i = std::uniform_int_distribution<int>(0, curr_num_anchors)(rand_gen);
+				curve.InsertAnchor(i, Eigen::VectorXd::Random(dim));
+			}
+			else if (edit == 1)
+			{
+				int i = std::uniform_int_distribution<int>(0, curr_num_anchors - 1)(rand_gen);
+				curve.MoveAnchor(i, Eigen::VectorXd::Random(dim));
+			}
+			else
+			{
+				int i = std::uniform_int_distribution<int>(0, curr_num_anchors - 1)(rand_gen);
+				curve.RemoveAnchor(i);
+			}
+			succ = matches_rebuild("edit " + std::to_string(e));
+		}
+
+		for (int a = 0; a < gNumCurveAdds && succ; ++a)
+		{
+			cCurve::tAnchor anchor;
+			anchor.mPos = Eigen::VectorXd::Random(dim);
+			curve.Add(anchor);
+			succ = matches_rebuild("add " + std::to_string(a));
+		}
+
+		while (curve.GetNumAnchors() > 0 && succ)
+		{
+			int i = std::uniform_int_distribution<int>(0, curve.GetNumAnchors() - 1)(rand_gen);
+			curve.RemoveAnchor(i);
+			succ = matches_rebuild("removing down to " + std::to_string(curve.GetNumAnchors()) + " anchors");
+		}
+	}
+
+	if (succ)
+	{
+		printf("Curve edit check passed, %i edits per curve type match a full rebuild\n", gNumCurveEdits);
+	}
+	return succ;
+}
+
+void BenchCurves(cBench& bench)
+{
+	const cCurve::eCurveType curve_types[] = { cCurve::eCurveTypeCatmullRom, cCurve::eCurveTypeBSpline };
+	const char* curve_type_names[] = { "catmull_rom", "b_spline" };
+	const int dims[] = { 3, 7, 27 };
+	const int anchor_counts[] = { 8, 64, 1024 };
+
+	for (int t = 0; t < 2; ++t)
+	{
+		for (int dim : dims)
+		{
+			for (int num_anchors : anchor_counts)
+			{
+				cCurve curve;
+				BuildCurve(curve_types[t], dim, num_anchors, curve);
+
+				// random times spread over the whole curve, so segment lookups are not coherent
+				Eigen::VectorXd times = (Eigen::VectorXd::Random(gNumSamples).array() + 1) * 0.5 * curve.GetMaxTime();
+				Eigen::VectorXd result = Eigen::VectorXd::Zero(dim);
+
+				Json::Value params;
+				params["Type"] = curve_type_names[t];
+				params["Dim"] = dim;
+				params["NumAnchors"] = num_anchors;
+
+				std::string suffix = std::string("/") + curve_type_names[t] + "/dim" + std::to_string(dim)
+									+ "/anchors" + std::to_string(num_anchors);
+
+				bench.Run("Curve.Eval" + suffix, params, [&](int num_iters)
+				{
+					for (int i = 0; i < num_iters; ++i)
+					{
+						curve.Eval(times[i & gSampleMask], result);
+						cBench::Sink(result[0]);
+					}
+				});
+
+				bench.Run("Curve.EvalTangent" + suffix, params, [&](int num_iters)
+				{
+					for (int i = 0; i < num_iters; ++i)
+					{
+						curve.EvalTangent(times[i & gSampleMask], result);
+						cBench::Sink(result[0]);
+					}
+				});
+
+				bench.Run("Curve.EvalNormal" + suffix, params, [&](int num_iters)
+				{
+					for (int i = 0; i < num_iters; ++i)
+					{
+						curve.EvalNormal(times[i & gSampleMask], result);
+						cBench::Sink(result[0]);
+					}
+				});
+			}
+		}
+	}
+}
+
+template <int Dim, class tBasis>
+void BenchSegKernels(cBench& bench, const std::string& basis_name, const std::string& kernel_name, int dim)
+{
+	typedef cCurveKernels<Dim, tBasis> tKernels;
+	const int num_segs = 64;
+	const int coeffs_size = dim * tKernels::gNumSegCoeffs;
+
+	Eigen::MatrixXd anchors = Eigen::MatrixXd::Random(dim, num_segs + tKernels::gNumSegCoeffs - 1);
+	Eigen::MatrixXd coeffs = Eigen::MatrixXd::Zero(coeffs_size, num_segs);
+	Eigen::VectorXd us = (Eigen::VectorXd::Random(gNumSamples).array() + 1) * 0.5;
+	Eigen::VectorXd seg_samples = (Eigen::VectorXd::Random(gNumSamples).array() + 1) * 0.5 * (num_segs - 1);
+	Eigen::VectorXd result = Eigen::VectorXd::Zero(dim);
+
+	for (int s = 0; s < num_segs; ++s)
+	{
+		const double* seg_anchors[tKernels::gNumSegCoeffs] = { anchors.col(s).data(), anchors.col(s + 1).data(),
+																anchors.col(s + 2).data(), anchors.col(s + 3).data() };
+		tKernels::BuildSegCoeffs(seg_anchors, dim, coeffs.col(s).data());
+	}
+
+	Json::Value params;
+	params["Type"] = basis_name;
+	params["Dim"] = dim;
+	params["Kernel"] = kernel_name;
+	std::string suffix = "/" + basis_name + "/dim" + std::to_string(dim) + "/" + kernel_name;
+
+	bench.Run("CurveKernels.BuildSegCoeffs" + suffix, params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			int s = i % num_segs;
+			const double* seg_anchors[tKernels::gNumSegCoeffs] = { anchors.col(s).data(), anchors.col(s + 1).data(),
+																	anchors.col(s + 2).data(), anchors.col(s + 3).data() };
+			tKernels::BuildSegCoeffs(seg_anchors, dim, coeffs.col(s).data());
+			cBench::Sink(coeffs(0, s));
+		}
+	});
+
+	bench.Run("CurveKernels.EvalSeg" + suffix, params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			int s = static_cast<int>(seg_samples[i & gSampleMask]);
+			tKernels::EvalSeg(coeffs.col(s).data(), dim, us[i & gSampleMask], result.data());
+			cBench::Sink(result[0]);
+		}
+	});
+
+	bench.Run("CurveKernels.EvalSegTangent" + suffix, params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			int s = static_cast<int>(seg_samples[i & gSampleMask]);
+			tKernels::EvalSegTangent(coeffs.col(s).data(), dim, us[i & gSampleMask], 1, result.data());
+			cBench::Sink(result[0]);
+		}
+	});
+}
+
+void BenchCurveKernels(cBench& bench)
+{
+	// the segment kernels that cCurve dispatches to, compared with the dynamic kernels
+	// at the dimensions of the bird path (3) and the biped poses (27), the fixed size 27
+	// kernels are not dispatched and are only measured to back that choice
+	BenchSegKernels<3, tCatmullRomBasis>(bench, "catmull_rom", "fixed", 3);
+	BenchSegKernels<Eigen::Dynamic, tCatmullRomBasis>(bench, "catmull_rom", "dynamic", 3);
+	BenchSegKernels<27, tCatmullRomBasis>(bench, "catmull_rom", "fixed", 27);
+	BenchSegKernels<Eigen::Dynamic, tCatmullRomBasis>(bench, "catmull_rom", "dynamic", 27);
+
+	BenchSegKernels<3, tBSplineBasis>(bench, "b_spline", "fixed", 3);
+	BenchSegKernels<Eigen::Dynamic, tBSplineBasis>(bench, "b_spline", "dynamic", 3);
+	BenchSegKernels<27, tBSplineBasis>(bench, "b_spline", "fixed", 27);
+	BenchSegKernels<Eigen::Dynamic, tBSplineBasis>(bench, "b_spline", "dynamic", 27);
+}
+
+void BenchFigure(cBench& bench)
+{
+	std::unique_ptr<cArticulatedFigure> figure(new cArticulatedFigure());
+	figure->Init();
+
+	int num_dofs = figure->GetNumDOFs();
+	Eigen::MatrixXd poses = Eigen::MatrixXd::Random(num_dofs, gNumSamples);
+	std::vector<Eigen::VectorXd> pose_vecs(gNumSamples);
+	for (int i = 0; i < gNumSamples; ++i)
+	{
+		pose_vecs[i] = poses.col(i);
+	}
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> joint_trans(figure->GetNumJoints());
+
+	Json::Value params;
+	params["NumJoints"] = figure->GetNumJoints();
+	params["NumDOFs"] = num_dofs;
+
+	bench.Run("ArticulatedFigure.SetPose", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			figure->SetPose(pose_vecs[i & gSampleMask]);
+		}
+	});
+
+	// only the last joint changes between poses, so a single joint is recomputed per update
+	int last_joint = figure->GetNumJoints() - 1;
+	int last_offset = figure->GetJointParamOffset(last_joint);
+	int last_size = figure->GetJointParamSize(last_joint);
+	std::vector<Eigen::VectorXd> partial_pose_vecs(gNumSamples);
+	for (int i = 0; i < gNumSamples; ++i)
+	{
+		partial_pose_vecs[i] = pose_vecs[0];
+		partial_pose_vecs[i].segment(last_offset, last_size) = pose_vecs[i].segment(last_offset, last_size);
+	}
+
+	bench.Run("ArticulatedFigure.SetPose.Partial", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			figure->SetPose(partial_pose_vecs[i & gSampleMask]);
+		}
+	});
+
+	std::vector<cArticulatedFigure::tQuatPose, Eigen::aligned_allocator<cArticulatedFigure::tQuatPose>> quat_poses(gNumSamples);
+	for (int i = 0; i < gNumSamples; ++i)
+	{
+		figure->BuildQuatPose(pose_vecs[i], quat_poses[i]);
+	}
+
+	bench.Run("ArticulatedFigure.SetPose.Quat", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			figure->SetPose(quat_poses[i & gSampleMask]);
+		}
+	});
+
+	bench.Run("ArticulatedFigure.ComputeFK", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			figure->ComputeFK(pose_vecs[i & gSampleMask], joint_trans.data());
+			cBench::Sink(joint_trans.back()(0, 3));
+		}
+	});
+
+	// FK for a crowd of characters, one pose at a time and in SoA batches
+	int num_joints = figure->GetNumJoints();
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> crowd_trans(gNumSamples * num_joints);
+	params["NumChars"] = gNumSamples;
+
+	bench.Run("ArticulatedFigure.ComputeFK.Crowd", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			for (int c = 0; c < gNumSamples; ++c)
+			{
+				figure->ComputeFK(pose_vecs[c], crowd_trans.data() + c * num_joints);
+			}
+			cBench::Sink(crowd_trans.back()(0, 3));
+		}
+	});
+
+	params["BatchSize"] = cArticulatedFigure::gFKBatchSize;
+	cArticulatedFigure::tFKBatchBuffer fk_buffer;
+	bench.Run("ArticulatedFigure.ComputeFKBatch.Crowd", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			figure->ComputeFKBatch(poses, 0, gNumSamples, fk_buffer, crowd_trans.data());
+			cBench::Sink(crowd_trans.back()(0, 3));
+		}
+	});
+}
+
+void BenchClip(cBench& bench)
+{
+	// plays back a real clip from the Euler angle curve, from quaternion keys and from the baked pose cache
+	std::unique_ptr<cArticulatedFigure> figure(new cArticulatedFigure());
+	figure->Init();
+
+	cCurve curve;
+	cPoseCurve pose_curve;
+	bool succ = curve.Load(gClipFile) && pose_curve.Init(curve, *figure);
+	if (!succ)
+	{
+		bench.AddNote("Clip", "failed to load " + gClipFile);
+		return;
+	}
+
+	double max_time = curve.GetMaxTime();
+	Eigen::VectorXd times = (Eigen::VectorXd::Random(gNumSamples).array() + 1) * (0.5 * max_time);
+
+	Json::Value params;
+	params["File"] = gClipFile;
+	params["NumJoints"] = figure->GetNumJoints();
+
+	Eigen::VectorXd pose;
+	bench.Run("Clip.Euler.SetPose", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			curve.Eval(times[i & gSampleMask], pose);
+			figure->SetPose(pose);
+		}
+	});
+
+	const char* interp_names[cPoseCurve::eRotInterpMax] = { "Nlerp", "Squad" };
+	cArticulatedFigure::tQuatPose quat_pose;
+	for (int m = 0; m < cPoseCurve::eRotInterpMax; ++m)
+	{
+		pose_curve.SetRotInterp(static_cast<cPoseCurve::eRotInterp>(m));
+		bench.Run(std::string("Clip.Quat.") + interp_names[m] + ".SetPose", params, [&](int num_iters)
+		{
+			for (int i = 0; i < num_iters; ++i)
+			{
+				pose_curve.Eval(times[i & gSampleMask], quat_pose);
+				figure->SetPose(quat_pose);
+			}
+		});
+	}
+
+	cPoseCache pose_cache;
+	pose_cache.Bake(curve);
+	params["FrameRate"] = pose_cache.GetFrameRate();
+	params["CacheBytes"] = static_cast<int>(pose_cache.GetMemSize());
+	bench.Run("Clip.Cache.Eval", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			pose_cache.Eval(times[i & gSampleMask], pose);
+			cBench::Sink(pose[0]);
+		}
+	});
+
+	bench.Run("Clip.Cache.SetPose", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			pose_cache.Eval(times[i & gSampleMask], pose);
+			figure->SetPose(pose);
+		}
+	});
+}
+
+void BenchMath(cBench& bench)
+{
+	tVectorArr eulers(gNumSamples);
+	tVectorArr axes(gNumSamples);
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mats(gNumSamples);
+	std::vector<tQuaternion, Eigen::aligned_allocator<tQuaternion>> quats(gNumSamples);
+	for (int i = 0; i < gNumSamples; ++i)
+	{
+		eulers[i] = tVector::Random() * M_PI;
+		eulers[i][3] = 0;
+		axes[i] = tVector::Random();
+		axes[i][3] = 0;
+		axes[i].normalize();
+		mats[i] = cMathUtil::RotateMat(eulers[i]);
+		quats[i] = cMathUtil::EulerToQuaternion(eulers[i]);
+	}
+	Json::Value params(Json::objectValue);
+
+	bench.Run("MathUtil.RotateMat(euler)", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			cBench::Sink(cMathUtil::RotateMat(eulers[i & gSampleMask])(0, 1));
+		}
+	});
+
+	bench.Run("MathUtil.RotateMat(axis, theta)", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			int s = i & gSampleMask;
+			cBench::Sink(cMathUtil::RotateMat(axes[s], eulers[s][0])(0, 1));
+		}
+	});
+
+	bench.Run("MathUtil.EulerToQuaternion", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			cBench::Sink(cMathUtil::EulerToQuaternion(eulers[i & gSampleMask]).w());
+		}
+	});
+
+	bench.Run("MathUtil.RotMatToEulerAngles", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			cBench::Sink(cMathUtil::RotMatToEulerAngles(mats[i & gSampleMask])[0]);
+		}
+	});
+
+	bench.Run("MathUtil.RotMatToQuaternion", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			cBench::Sink(cMathUtil::RotMatToQuaternion(mats[i & gSampleMask]).w());
+		}
+	});
+
+	bench.Run("MathUtil.QuatRotVec", params, [&](int num_iters)
+	{
+		for (int i = 0; i < num_iters; ++i)
+		{
+			int s = i & gSampleMask;
+			cBench::Sink(cMathUtil::QuatRotVec(quats[s], axes[s])[0]);
+		}
+	});
+}
+
+void BenchMesh(cBench& bench)
+{
+	// loading a mesh uploads it to the gpu, so this needs an OpenGL context,
+	// which is provided by a hidden window
+	try
+	{
+		nanogui::init();
+	}
+	catch (const std::runtime_error& e)
+	{
+		bench.AddNote("OBJParser.LoadMesh", std::string("no OpenGL context, ") + e.what());
+		return;
+	}
+
+	{
+		nanogui::ref<nanogui::Screen> screen = new nanogui::Screen(Eigen::Vector2i(64, 64), "cpsc426Bench", false);
+
+		Json::Value params;
+		params["File"] = gMeshFile;
+
+		bench.Run("OBJParser.LoadMesh", params, [&](int num_iters)
+		{
+			for (int i = 0; i < num_iters; ++i)
+			{
+				cDrawMesh mesh;
+				bool succ = cOBJParser::LoadMesh(gMeshFile, mesh);
+				cBench::Sink(succ);
+			}
+		});
+	}
+
+	nanogui::shutdown();
+}
+
+int main(int argc, char** argv)
+{
+	cBench bench;
+	std::string output_file = gDefaultOutputFile;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool has_val = i + 1 < argc;
+		if (arg == "-o" && has_val)
+		{
+			output_file = argv[++i];
+		}
+		else if (arg == "-filter" && has_val)
+		{
+			bench.SetFilter(argv[++i]);
+		}
+		else if (arg == "-min_time" && has_val)
+		{
+			bench.SetMinTime(std::atof(argv[++i]));
+		}
+		else if (arg == "-reps" && has_val)
+		{
+			bench.SetNumReps(std::atoi(argv[++i]));
+		}
+		else
+		{
+			printf("Usage: %s [-o results.json] [-filter substring] [-min_time seconds] [-reps n]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	bool succ = CheckCurveEdits();
+
+	BenchCurves(bench);
+	BenchCurveKernels(bench);
+	BenchFigure(bench);
+	BenchClip(bench);
+	BenchMath(bench);
+	BenchMesh(bench);
+
+	succ &= bench.WriteJson(output_file);
+	return (succ) ? 0 : -1;
+}
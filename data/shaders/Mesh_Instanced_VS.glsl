@@ -0,0 +1,30 @@
+#version 330
+
+uniform mat4 gProjMatrix;
+uniform mat4 gModelViewMatrix;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+// per instance attributes, see cDrawMesh::DrawInstances
+layout(location = 3) in mat4 inInstanceTrans;
+layout(location = 7) in vec4 inInstanceColor;
+
+out vec3 ViewPos;
+out vec3 Normal;
+out vec2 TexCoord;
+out vec4 Color;
+
+void main()
+{
+	mat4 model_view = gModelViewMatrix * inInstanceTrans;
+	vec4 view_pos = model_view * vec4(inPosition.xyz, 1.f);
+	vec4 WVP_Pos = gProjMatrix * view_pos;
+
+	gl_Position = WVP_Pos;
+	ViewPos = view_pos.xyz;
+	Normal = (model_view * vec4(inNormal.xyz, 0.f)).xyz;
+	TexCoord = inTexCoord.xy;
+	Color = inInstanceColor;
+}
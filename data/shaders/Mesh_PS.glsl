@@ -1,6 +1,5 @@
 #version 330
 
-uniform		vec4		gColor;
 uniform		vec3		gLightDir;
 uniform		vec3		gLightColour;
 uniform		vec3		gAmbientColour;
@@ -8,6 +7,7 @@ uniform		vec3		gAmbientColour;
 in		vec3	ViewPos;
 in		vec3	Normal;
 in		vec2	TexCoord;
+in		vec4	Color;
 
 out		vec4	out_color;
 
@@ -41,7 +41,7 @@ void main()
 	vec3 view_dir = -normalize(ViewPos);
 	vec3 norm = normalize(Normal);
 
-	vec3 albedo = gColor.rgb;
+	vec3 albedo = Color.rgb;
 
 	vec3 light_colour = gLightColour;
 	vec3 light_dir = gLightDir;
@@ -52,5 +52,5 @@ void main()
 	vec3 ambient = CalcAmbient(norm, albedo);
 	light_result.rgb += ambient;
 
-	out_color = vec4(light_result, gColor.a);
+	out_color = vec4(light_result, Color.a);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 uniform mat4 gProjMatrix;
 uniform mat4 gModelViewMatrix;
+uniform vec4 gColor;
 
 in vec3 inPosition;
 in vec3 inNormal;
@@ -10,6 +11,7 @@ in vec2 inTexCoord;
 out vec3 ViewPos;
 out vec3 Normal;
 out vec2 TexCoord;
+out vec4 Color;
 
 void main()
 {
@@ -20,4 +22,5 @@ void main()
 	ViewPos = view_pos.xyz;
 	Normal = (gModelViewMatrix * vec4(inNormal.xyz, 0.f)).xyz;
 	TexCoord = inTexCoord.xy;
+	Color = gColor;
 }
\ No newline at end of file
@@ -114,6 +114,13 @@ project "CPSC426"
 	{ -- Files to exclude from this project but match the above regular expression(s)
 		"Curve.cpp",
 		"Curve.h",
+		"CurveT.h",
+		"CurveCursor.cpp",
+		"CurveCursor.h",
+		"PoseCurve.cpp",
+		"PoseCurve.h",
+		"PoseCache.cpp",
+		"PoseCache.h",
 		"ArticulatedFigure.cpp",
 		"ArticulatedFigure.h",
 	}	
@@ -242,6 +249,140 @@ project "CPSC426"
 			"pthread"
 		}
 
+project "cpsc426Bench"
+	language "C++"
+	kind "ConsoleApp"
+
+	files { 
+		-- micro-benchmarks for the curve, kinematics and mesh code
+		"bench/*.cpp",
+		"bench/*.h",
+	}
+	includedirs { 
+		"./",
+		"include/eigen",
+		"include/glfw/include",
+		"include/nanovg/src",
+		"jsoncpp/include",
+		"scenarios",
+		"util"
+	}
+	links {
+		"glfw",
+		"cpsc426Util",
+		"nanoGUI",
+		"jsoncpp",
+		"cpsc426Render",
+		"nanovg",
+		"cpsc426Scenario",
+	}
+
+	defines { -- preprocessor defines for this project
+		"_CRT_SECURE_NO_WARNINGS",
+		"_SCL_SECURE_NO_WARNINGS",
+	}
+
+	buildoptions("-std=c++0x -ggdb" ) -- allows for debuging	
+
+	-- linux library cflags and libs
+	configuration { "linux", "gmake" }
+		buildoptions { 
+			"`pkg-config --cflags gl`",
+			"`pkg-config --cflags glu`" 
+		}
+		linkoptions { 
+			"-Wl,-rpath," .. path.getabsolute("lib") ,
+			"`pkg-config --libs gl`",
+			"`pkg-config --libs glu`" 
+		}
+		libdirs { 
+			-- "lib",
+		}
+		links {
+			"X11",
+			"Xrandr",
+			"Xi",
+			"Xxf86vm",
+			"Xinerama",
+			"Xcursor",
+		}
+		
+		includedirs { 
+
+		}
+		defines {
+			"_LINUX_",
+		}
+			-- debug configs
+		configuration { "linux", "Debug*", "gmake"}
+			links {
+				"dl",
+				"pthread",
+			}
+	 
+	 	-- release configs
+		configuration { "linux", "Release*", "gmake"}
+			defines { "NDEBUG" }
+			links {
+				"dl",
+				"pthread",
+			}
+
+	-- windows library cflags and libs
+	configuration { "windows" }
+		-- libdirs { "lib" }
+		linkoptions  { 
+		}
+		files {
+			-- "include/glad/src/*.c",	
+		}
+		defines {
+			"_USE_MATH_DEFINES",
+			"NANOGUI_GLAD",
+			"NANOGUI_EIGEN_DONT_ALIGN",
+			"GLAD_GLAPI_EXPORT" -- Because each library must have the same calling convention
+		}
+		includedirs { 
+			"include/glad/include",
+		}	
+		
+		libdirs { 
+			"lib",
+		}
+		
+		-- release configs
+		configuration { "windows", "Debug*"}
+			defines { "DEBUG" }
+			links { 
+				"opengl32",
+				"glu32",
+				"glew32",
+			}
+
+		-- release configs
+		configuration { "windows", "Release*"}
+			defines { "NDEBUG" }
+			links { 
+				"opengl32",
+				"glu32",
+				"glew32",
+			}
+
+	-- mac includes and libs
+	configuration { "macosx" }
+		kind "ConsoleApp" -- xcode4 failes to run the project if using WindowedApp
+		-- includedirs { "/Library/Frameworks/SDL.framework/Headers" }
+		buildoptions { "-Wunused-value -Wshadow -Wreorder -Wsign-compare -Wall" }
+		linkoptions { 
+			"-Wl,-rpath," .. path.getabsolute("lib") ,
+		}
+		links { 
+			"OpenGL.framework", 
+			"Cocoa.framework",
+			"dl",
+			"pthread"
+		}
+
 project "cpsc426Util"
 	language "C++"
 	kind "SharedLib"
@@ -370,6 +511,13 @@ project "cpsc426Scenario"
 		"scenarios/*.cpp",
 		"Curve.cpp",
 		"Curve.h",
+		"CurveT.h",
+		"CurveCursor.cpp",
+		"CurveCursor.h",
+		"PoseCurve.cpp",
+		"PoseCurve.h",
+		"PoseCache.cpp",
+		"PoseCache.h",
 		"ArticulatedFigure.cpp",
 		"ArticulatedFigure.h",
 	}
@@ -501,6 +649,54 @@ project "cpsc426Scenario"
             }
 
 
+project "cpsc426CurveConverter"
+	language "C++"
+	kind "ConsoleApp"
+
+	files { 
+		-- offline tool that converts JSON curve files to the binary curve format
+		"tools/CurveConverter.cpp",
+		"Curve.cpp",
+		"Curve.h",
+		"CurveT.h",
+	}
+	includedirs { 
+		"./",
+		"include/eigen",
+		"jsoncpp/include",
+	}
+	links {
+		"jsoncpp",
+		"cpsc426Util",
+	}
+
+	defines {
+		"_CRT_SECURE_NO_WARNINGS",
+		"_SCL_SECURE_NO_WARNINGS",
+	}
+
+	buildoptions("-std=c++0x -ggdb" )
+
+	configuration { "linux", "gmake" }
+		linkoptions { 
+			"-Wl,-rpath," .. path.getabsolute("lib") ,
+		}
+		defines {
+			"_LINUX_",
+		}
+
+	configuration { "windows" }
+		defines {
+			"_USE_MATH_DEFINES",
+		}
+
+	configuration { "macosx" }
+		buildoptions { "-Wunused-value -Wshadow -Wreorder -Wsign-compare -Wall" }
+		linkoptions { 
+			"-Wl,-rpath," .. path.getabsolute("lib") ,
+		}
+
+
 
 
 project "cpsc426Render"
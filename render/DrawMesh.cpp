@@ -18,12 +18,14 @@
 #include "render/DrawMesh.h"
 #include "render/DrawUtil.h"
 
-cDrawMesh::cDrawMesh() : mNumElem(0), mVbos(0)
+cDrawMesh::cDrawMesh() : mNumElem(0), mVbos(0), mInstanceBuffer(0), mInstanceBytes(0)
 {
 }
 
 cDrawMesh::~cDrawMesh()
 {
+	if (mInstanceBuffer != 0)
+		glDeleteBuffers(1, &mInstanceBuffer);
 }
 
 void cDrawMesh::Init(int num_buffers)
@@ -42,11 +44,35 @@ void cDrawMesh::Draw(GLenum primitive)
 {
 	cDrawUtil::SyncMatrices();
 
+	// buffers that have not changed since the last draw are skipped,
+	// so static meshes only bind their VAO
 	mState.BindVAO();
 	SyncGPU(0, 0);
 	glDrawElements(primitive, mNumElem, GL_UNSIGNED_INT, 0);
 }
 
+void cDrawMesh::Draw(GLenum primitive, int elem_beg, int num_elems)
+{
+	cDrawUtil::SyncMatrices();
+
+	mState.BindVAO();
+	SyncGPU(0, 0);
+	glDrawElements(primitive, num_elems, GL_UNSIGNED_INT, (GLvoid *)(elem_beg * sizeof(GLuint)));
+}
+
+void cDrawMesh::DrawInstances(int num_instances, const float* instance_data, GLenum primitive)
+{
+	if (num_instances <= 0)
+		return;
+
+	cDrawUtil::SyncMatrices();
+
+	mState.BindVAO();
+	SyncGPU(0, 0);
+	SyncInstances(num_instances, instance_data);
+	glDrawElementsInstanced(primitive, mNumElem, GL_UNSIGNED_INT, 0, num_instances);
+}
+
 void cDrawMesh::AddBuffer(int buff_num)
 {
 	mVbos.push_back(cVertexBuffer(buff_num, mState));
@@ -78,12 +104,46 @@ void cDrawMesh::SyncGPU(unsigned int base, size_t extent)
 
 	// bind the vertex array object to store all the vertex settings
 	mState.BindVAO();
-	for (unsigned int i = base; i < extent; i++)
+	for (unsigned int i = base; i < base + extent; i++)
 		mVbos[i].SyncBuffer();
 
 	mIbo.SyncBuffer();
 }
 
+// the instance data changes every draw, so the buffer is orphaned and refilled each time
+// the instance attributes are part of the VAO and only need to be set up once
+void cDrawMesh::SyncInstances(int num_instances, const float* instance_data)
+{
+	const GLsizei stride = gInstanceSize * sizeof(float);
+	size_t num_bytes = num_instances * stride;
+
+	bool init_attribs = mInstanceBuffer == 0;
+	if (init_attribs)
+		glGenBuffers(1, &mInstanceBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+	if (mInstanceBytes < num_bytes)
+		mInstanceBytes = num_bytes;
+	glBufferData(GL_ARRAY_BUFFER, mInstanceBytes, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, num_bytes, instance_data);
+
+	if (init_attribs)
+	{
+		const int mat_cols = 4;
+		for (int i = 0; i < mat_cols; ++i)
+		{
+			GLuint attrib = gInstanceTransAttrib + i;
+			glEnableVertexAttribArray(attrib);
+			glVertexAttribPointer(attrib, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(i * 4 * sizeof(float)));
+			glVertexAttribDivisor(attrib, 1);
+		}
+
+		glEnableVertexAttribArray(gInstanceColorAttrib);
+		glVertexAttribPointer(gInstanceColorAttrib, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(mat_cols * 4 * sizeof(float)));
+		glVertexAttribDivisor(gInstanceColorAttrib, 1);
+	}
+}
+
 int cDrawMesh::GetNumFaces() const
 {
 	const int verts_per_face = 3;
@@ -29,6 +29,11 @@
 class PLUGIN_EXPORT cDrawMesh
 {
 public:
+	// layout of the per instance data used by DrawInstances, each instance is a column major
+	// 4x4 model matrix followed by an rgba color, matching data/shaders/Mesh_Instanced_VS.glsl
+	static const int gInstanceTransAttrib = 3; // the matrix takes up 4 attribute slots
+	static const int gInstanceColorAttrib = 7;
+	static const int gInstanceSize = 20; // floats per instance
 
 	cDrawMesh();
 	~cDrawMesh();
@@ -36,6 +41,9 @@ public:
 	// AND an ibo
 	void Init(int num_buffers);
 	void Draw(GLenum primitive = GL_TRIANGLES);
+	void Draw(GLenum primitive, int elem_beg, int num_elems); // draws only the elements in [elem_beg, elem_beg + num_elems)
+	// draws num_instances copies of the mesh with a single draw call, instance_data holds gInstanceSize floats per instance
+	void DrawInstances(int num_instances, const float* instance_data, GLenum primitive = GL_TRIANGLES);
 
 	void AddBuffer(int buff_num);
 
@@ -55,10 +63,14 @@ public:
 
 private:
 	void ResizeBuffer(int size);            // resize the internal store for the buffer
+	void SyncInstances(int num_instances, const float* instance_data);
 
 	GLsizei  mNumElem;
 	cIBuffer  mIbo;
 
 	cRenderState    mState;
 	std::vector<cVertexBuffer> mVbos;
+
+	GLuint   mInstanceBuffer;  // streamed every instanced draw, 0 until the first one
+	size_t   mInstanceBytes;   // allocated size of the instance buffer
 };
@@ -1,22 +1,36 @@
 #include "DrawUtil.h"
+#include <algorithm>
 #include <nanogui/opengl.h>
 #include "render/Shader.h"
 
 tVector cDrawUtil::gColor = tVector::Ones();
+double cDrawUtil::gLineWidth = 1;
+double cDrawUtil::gPointSize = 1;
 cDrawUtil::eMatrixMode cDrawUtil::mMatrixMode = cDrawUtil::eMatrixModeModelView;
 
 const int gNumSlice = 16;
 const int gNumStacks = 8;
 const int gDiskSlices = 32;
+const double gParallelogramTol = 1e-6; // relative to the size of a quad
 
 std::unique_ptr<cDrawMesh> cDrawUtil::gPointMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gLineMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gQuadMesh = nullptr;
+std::unique_ptr<cDrawMesh> cDrawUtil::gDynamicQuadMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gBoxMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gSphereMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gDiskMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gTriangleMesh = nullptr;
 std::unique_ptr<cDrawMesh> cDrawUtil::gCylinderMesh = nullptr;
+std::vector<float> cDrawUtil::gInstanceData = std::vector<float>();
+
+bool cDrawUtil::gDeferred = false;
+cShader* cDrawUtil::gInstanceShader = nullptr;
+std::vector<cDrawUtil::tDrawCmd, Eigen::aligned_allocator<cDrawUtil::tDrawCmd>> cDrawUtil::gDrawCmds = std::vector<cDrawUtil::tDrawCmd, Eigen::aligned_allocator<cDrawUtil::tDrawCmd>>();
+std::unique_ptr<cDrawMesh> cDrawUtil::gDeferredMesh = nullptr;
+std::vector<float> cDrawUtil::gDeferredPos = std::vector<float>();
+std::vector<float> cDrawUtil::gDeferredNorm = std::vector<float>();
+int cDrawUtil::gDeferredCapacity = 0;
 
 std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> cDrawUtil::mMatrixStackProj = std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>>();
 std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> cDrawUtil::mMatrixStackModelView = std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>>();
@@ -39,89 +53,99 @@ void cDrawUtil::InitDrawUtil()
 	mMatrixStackModelView.push_back(tMatrix::Identity());
 
 	gColor.setIdentity();
+	gLineWidth = 1;
+	gPointSize = 1;
 
 	gShader = nullptr;
+	gDeferred = false;
+	gInstanceShader = nullptr;
+	gDrawCmds.clear();
+
+	// the deferred mesh was just rebuilt, so its indices and texture coordinates have to be loaded again
+	gDeferredPos.clear();
+	gDeferredNorm.clear();
+	gDeferredCapacity = 0;
+}
+
+void cDrawUtil::BeginDeferred(cShader* instance_shader)
+{
+	gDeferred = true;
+	gInstanceShader = instance_shader;
+	gDrawCmds.clear();
+}
+
+void cDrawUtil::FlushDeferred()
+{
+	// anything drawn from here on goes straight to the GPU again
+	gDeferred = false;
+	if (!gDrawCmds.empty())
+	{
+		// commands are grouped by shader, mesh and primitive, and then by color and size,
+		// the sort is stable so the submission order is kept within a group
+		std::stable_sort(gDrawCmds.begin(), gDrawCmds.end(), CompareDrawCmds);
+		BuildDeferredMesh();
+
+		// the recorded matrices already include the model view matrix
+		cShader* prev_shader = gShader;
+		tVector prev_color = gColor;
+		eMatrixMode prev_mode = mMatrixMode;
+		MatrixMode(eMatrixModeModelView);
+		PushMatrix();
+		LoadIdentityMatrix();
+
+		int num_cmds = static_cast<int>(gDrawCmds.size());
+		int cmd_beg = 0;
+		int vert_offset = 0;
+		while (cmd_beg < num_cmds)
+		{
+			int cmd_end = cmd_beg + 1;
+			while (cmd_end < num_cmds && SameDrawRun(gDrawCmds[cmd_beg], gDrawCmds[cmd_end]))
+			{
+				++cmd_end;
+			}
+			FlushDrawRun(cmd_beg, cmd_end, vert_offset);
+			cmd_beg = cmd_end;
+		}
+
+		PopMatrix();
+		MatrixMode(prev_mode);
+		if (prev_shader != nullptr)
+		{
+			BindShader(prev_shader);
+		}
+		SetColor(prev_color);
+		SetLineWidth(gLineWidth);
+		SetPointSize(gPointSize);
+	}
+
+	gDrawCmds.clear();
+	gInstanceShader = nullptr;
+}
+
+bool cDrawUtil::IsDeferred()
+{
+	return gDeferred;
 }
 
 void cDrawUtil::DrawRect(const tVector& pos, const tVector& size, eDrawMode draw_mode)
 {
-	tVector a = tVector(pos[0] - 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2], 0);
-	tVector b = tVector(pos[0] + 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2], 0);
-	tVector c = tVector(pos[0] + 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2], 0);
-	tVector d = tVector(pos[0] - 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2], 0);
-	DrawQuad(a, b, c, d, draw_mode);
+	GLenum gl_mode = (draw_mode == eDrawSolid) ? GL_TRIANGLE_FAN : GL_LINE_LOOP;
+	PushMatrix();
+	Translate(tVector(pos[0] - 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2], 0));
+	Scale(tVector(size[0], size[1], 1, 1));
+	gQuadMesh->Draw(gl_mode);
+	PopMatrix();
 }
 
 void cDrawUtil::DrawBox(const tVector& pos, const tVector& size, eDrawMode draw_mode)
 {
+	// the unit box is centered at the origin, so the box only needs to be scaled and moved into place
 	GLenum gl_mode = (draw_mode == eDrawSolid) ? GL_TRIANGLES : GL_LINE_LOOP;
-	
-	const int num_faces = 6;
-	const int pos_len = num_faces * 6 * cMeshUtil::gPosDim;
-
-	tVector sw0 = tVector(pos[0] - 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2] - 0.5 * size[2], 0);
-	tVector se0 = tVector(pos[0] + 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2] - 0.5 * size[2], 0);
-	tVector ne0 = tVector(pos[0] + 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2] - 0.5 * size[2], 0);
-	tVector nw0 = tVector(pos[0] - 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2] - 0.5 * size[2], 0);
-
-	tVector sw1 = tVector(pos[0] - 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2] + 0.5 * size[2], 0);
-	tVector se1 = tVector(pos[0] + 0.5 * size[0], pos[1] - 0.5 * size[1], pos[2] + 0.5 * size[2], 0);
-	tVector ne1 = tVector(pos[0] + 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2] + 0.5 * size[2], 0);
-	tVector nw1 = tVector(pos[0] - 0.5 * size[0], pos[1] + 0.5 * size[1], pos[2] + 0.5 * size[2], 0);
-
-	const float pos_data[pos_len] = {
-		ne0[0], ne0[1], ne0[2], // top
-		nw0[0], nw0[1], nw0[2],
-		nw1[0], nw1[1], nw1[2],
-		nw1[0], nw1[1], nw1[2],
-		ne1[0], ne1[1], ne1[2],
-		ne0[0], ne0[1], ne0[2],
-
-		se1[0], se1[1], se1[2],  // bottom
-		sw1[0], sw1[1], sw1[2],
-		sw0[0], sw0[1], sw0[2],
-		sw0[0], sw0[1], sw0[2],
-		se0[0], se0[1], se0[2],
-		se1[0], se1[1], se1[2],
-
-		se1[0], se1[1], se1[2], // front
-		se0[0], se0[1], se0[2],
-		ne0[0], ne0[1], ne0[2],
-		ne0[0], ne0[1], ne0[2],
-		ne1[0], ne1[1], ne1[2],
-		se1[0], se1[1], se1[2],
-
-		sw0[0], sw0[1], sw0[2], // back
-		sw1[0], sw1[1], sw1[2],
-		nw1[0], nw1[1], nw1[2],
-		nw1[0], nw1[1], nw1[2],
-		nw0[0], nw0[1], nw0[2],
-		sw0[0], sw0[1], sw0[2],
-
-		sw0[0], sw0[1], sw0[2], // left
-		nw0[0], nw0[1], nw0[2],
-		ne0[0], ne0[1], ne0[2],
-		ne0[0], ne0[1], ne0[2],
-		se0[0], se0[1], se0[2],
-		sw0[0], sw0[1], sw0[2],
-
-		se1[0], se1[1], se1[2], // right
-		ne1[0], ne1[1], ne1[2],
-		nw1[0], nw1[1], nw1[2],
-		nw1[0], nw1[1], nw1[2],
-		sw1[0], sw1[1], sw1[2],
-		se1[0], se1[1], se1[2]
-	};
-
-	tAttribInfo attr_info;
-	attr_info.mAttribNumber = cMeshUtil::eAttributePosition;
-	attr_info.mAttribSize = sizeof(pos_data[0]);
-	attr_info.mDataOffset = 0;
-	attr_info.mDataStride = 0;
-	attr_info.mNumComp = cMeshUtil::gPosDim;
-	gBoxMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
-
-	gBoxMesh->Draw(gl_mode);
+	PushMatrix();
+	Translate(pos);
+	Scale(tVector(size[0], size[1], size[2], 1));
+	SubmitMesh(*gBoxMesh, gl_mode);
+	PopMatrix();
 }
 
 void cDrawUtil::DrawTriangle(const tVector& pos, double side_len, eDrawMode draw_mode)
@@ -136,8 +160,32 @@ void cDrawUtil::DrawTriangle(const tVector& pos, double side_len, eDrawMode draw
 
 void cDrawUtil::DrawQuad(const tVector& a, const tVector& b, const tVector& c, const tVector& d, eDrawMode draw_mode)
 {
-	DrawQuad(a, b, c, d, tVector(0, 0, 0, 0), tVector(1, 0, 0, 0),
-		tVector(1, 1, 0, 0), tVector(0, 1, 0, 0), draw_mode);
+	tVector u = b - a;
+	tVector v = d - a;
+	double quad_size = std::max(u.squaredNorm(), v.squaredNorm());
+	bool parallelogram = (c - b - v).squaredNorm() <= gParallelogramTol * gParallelogramTol * quad_size;
+
+	if (parallelogram)
+	{
+		// the unit quad spans [0, 1] x [0, 1], so a parallelogram is just an affine transform of it
+		GLenum gl_mode = (draw_mode == eDrawSolid) ? GL_TRIANGLE_FAN : GL_LINE_LOOP;
+		tMatrix quad_trans = tMatrix::Identity();
+		quad_trans.col(0) = u;
+		quad_trans.col(1) = v;
+		quad_trans.col(2) = CalcQuadNormal(a, b, d);
+		quad_trans.col(3) = a;
+		quad_trans.row(3) = tVector(0, 0, 0, 1);
+
+		PushMatrix();
+		MultMatrix(quad_trans);
+		gQuadMesh->Draw(gl_mode);
+		PopMatrix();
+	}
+	else
+	{
+		DrawQuad(a, b, c, d, tVector(0, 0, 0, 0), tVector(1, 0, 0, 0),
+			tVector(1, 1, 0, 0), tVector(0, 1, 0, 0), draw_mode);
+	}
 }
 
 void cDrawUtil::DrawQuad(const tVector& a, const tVector& b, const tVector& c, const tVector& d,
@@ -150,17 +198,7 @@ void cDrawUtil::DrawQuad(const tVector& a, const tVector& b, const tVector& c, c
 	const int coord_len = num_verts * cMeshUtil::gCoordDim;
 
 	GLenum gl_mode = (draw_mode == eDrawSolid) ? GL_TRIANGLE_FAN : GL_LINE_LOOP;
-
-	tVector normal = (b - a).cross3(d - a);
-	double normal_len = normal.norm();
-	if (normal_len == 0)
-	{
-		normal = tVector(0, 0, 1, 0);
-	}
-	else
-	{
-		normal = (normal / normal_len);
-	}
+	tVector normal = CalcQuadNormal(a, b, d);
 
 	const float pos_data[pos_len] =
 	{
@@ -192,23 +230,23 @@ void cDrawUtil::DrawQuad(const tVector& a, const tVector& b, const tVector& c, c
 	attr_info.mDataOffset = 0;
 	attr_info.mDataStride = 0;
 	attr_info.mNumComp = cMeshUtil::gPosDim;
-	gQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
+	gDynamicQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
 
 	attr_info.mAttribNumber = cMeshUtil::eAttributeNormal;
 	attr_info.mAttribSize = sizeof(norm_data[0]);
 	attr_info.mDataOffset = 0;
 	attr_info.mDataStride = 0;
 	attr_info.mNumComp = cMeshUtil::gNormDim;
-	gQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * norm_len, (GLubyte*)norm_data, 0, 1, &attr_info);
+	gDynamicQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * norm_len, (GLubyte*)norm_data, 0, 1, &attr_info);
 
 	attr_info.mAttribNumber = cMeshUtil::eAttributeCoord;
 	attr_info.mAttribSize = sizeof(norm_data[0]);
 	attr_info.mDataOffset = 0;
 	attr_info.mDataStride = 0;
 	attr_info.mNumComp = cMeshUtil::gCoordDim;
-	gQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * coord_len, (GLubyte*)coord_data, 0, 1, &attr_info);
+	gDynamicQuadMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * coord_len, (GLubyte*)coord_data, 0, 1, &attr_info);
 
-	gQuadMesh->Draw(gl_mode);
+	gDynamicQuadMesh->Draw(gl_mode);
 }
 
 void cDrawUtil::DrawDisk(const tVector& pos, double r, eDrawMode draw_mode)
@@ -230,43 +268,24 @@ void cDrawUtil::DrawDisk(double r, eDrawMode draw_mode)
 
 void cDrawUtil::DrawPoint(const tVector& pt)
 {
-	const int num_verts = 1;
-	const int pos_len = num_verts * cMeshUtil::gPosDim;
-	const float pos_data[pos_len] =
-	{
-		pt[0], pt[1], pt[2]
-	};
-
-	tAttribInfo attr_info;
-	attr_info.mAttribNumber = cMeshUtil::eAttributePosition;
-	attr_info.mAttribSize = sizeof(pos_data[0]);
-	attr_info.mDataOffset = 0;
-	attr_info.mDataStride = 0;
-	attr_info.mNumComp = cMeshUtil::gPosDim;
-	gPointMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
-
-	gPointMesh->Draw(GL_POINTS);
+	PushMatrix();
+	Translate(pt);
+	SubmitMesh(*gPointMesh, GL_POINTS);
+	PopMatrix();
 }
 
 void cDrawUtil::DrawLine(const tVector& a, const tVector& b)
 {
-	const int num_verts = 2;
-	const int pos_len = num_verts * cMeshUtil::gPosDim;
-	const float pos_data[pos_len] =
-	{
-		a[0], a[1], a[2],
-		b[0], b[1], b[2],
-	};
-
-	tAttribInfo attr_info;
-	attr_info.mAttribNumber = cMeshUtil::eAttributePosition;
-	attr_info.mAttribSize = sizeof(pos_data[0]);
-	attr_info.mDataOffset = 0;
-	attr_info.mDataStride = 0;
-	attr_info.mNumComp = cMeshUtil::gPosDim;
-	gLineMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
+	// the unit line runs from the origin along the x axis
+	tMatrix line_trans = tMatrix::Identity();
+	line_trans.col(0) = b - a;
+	line_trans.col(3) = a;
+	line_trans.row(3) = tVector(0, 0, 0, 1);
 
-	gLineMesh->Draw(GL_LINES);
+	PushMatrix();
+	MultMatrix(line_trans);
+	SubmitMesh(*gLineMesh, GL_LINES);
+	PopMatrix();
 }
 
 void cDrawUtil::DrawSphere(double r, eDrawMode draw_mode)
@@ -274,85 +293,17 @@ void cDrawUtil::DrawSphere(double r, eDrawMode draw_mode)
 	cDrawUtil::PushMatrix();
 	cDrawUtil::Scale(tVector(r, r, r, 1));
 	GLenum gl_mode = (draw_mode == eDrawWire) ? GL_LINES : GL_TRIANGLES;
-	gSphereMesh->Draw(gl_mode);
+	SubmitMesh(*gSphereMesh, gl_mode);
 	cDrawUtil::PopMatrix();
 }
 
 void cDrawUtil::DrawCylinder(double h, double r, eDrawMode draw_mode)
 {
 	GLenum gl_mode = (draw_mode == eDrawWire) ? GL_LINES : GL_TRIANGLES;
-	const int slices = gNumSlice;
-	const int num_verts = 12 * slices;
-	const int pos_size = cMeshUtil::gPosDim;
-	const int norm_size = cMeshUtil::gNormDim;
-	const int coord_size = cMeshUtil::gCoordDim;
-	const int pos_len = num_verts * pos_size;
-
-	float pos_data[pos_len];
-	for (int i = 0; i < slices; ++i)
-	{
-		double theta0 = (i * 2 * M_PI) / slices;
-		double theta1 = ((i + 1) * 2 * M_PI) / slices;
-
-		double x0 = r * std::cos(theta0);
-		double z0 = r * std::sin(-theta0);
-
-		double x1 = r * std::cos(theta1);
-		double z1 = r * std::sin(-theta1);
-
-		tVector n0 = tVector(x0, 0, z0, 0).normalized();
-		tVector n1 = tVector(x1, 0, z1, 0).normalized();
-
-		int pos_offset = i * 12 * pos_size;
-
-		pos_data[pos_offset] = x0;
-		pos_data[pos_offset + 1] = -0.5 * h;
-		pos_data[pos_offset + 2] = z0;
-		pos_data[pos_offset + 3] = x1;
-		pos_data[pos_offset + 4] = -0.5 * h;
-		pos_data[pos_offset + 5] = z1;
-		pos_data[pos_offset + 6] = x1;
-		pos_data[pos_offset + 7] = 0.5 * h;
-		pos_data[pos_offset + 8] = z1;
-		pos_data[pos_offset + 9] = x1;
-		pos_data[pos_offset + 10] = 0.5 * h;
-		pos_data[pos_offset + 11] = z1;
-		pos_data[pos_offset + 12] = x0;
-		pos_data[pos_offset + 13] = 0.5 * h;
-		pos_data[pos_offset + 14] = z0;
-		pos_data[pos_offset + 15] = x0;
-		pos_data[pos_offset + 16] = -0.5 * h;
-		pos_data[pos_offset + 17] = z0;
-
-		pos_data[pos_offset + 18] = x0;
-		pos_data[pos_offset + 19] = 0.5 * h;
-		pos_data[pos_offset + 20] = z0;
-		pos_data[pos_offset + 21] = x1;
-		pos_data[pos_offset + 22] = 0.5 * h;
-		pos_data[pos_offset + 23] = z1;
-		pos_data[pos_offset + 24] = 0;
-		pos_data[pos_offset + 25] = 0.5 * h;
-		pos_data[pos_offset + 26] = 0;
-		pos_data[pos_offset + 27] = 0;
-		pos_data[pos_offset + 28] = -0.5 * h;
-		pos_data[pos_offset + 29] = 0;
-		pos_data[pos_offset + 30] = x1;
-		pos_data[pos_offset + 31] = -0.5 * h;
-		pos_data[pos_offset + 32] = z1;
-		pos_data[pos_offset + 33] = x0;
-		pos_data[pos_offset + 34] = -0.5 * h;
-		pos_data[pos_offset + 35] = z0;
-	}
-
-	tAttribInfo attr_info;
-	attr_info.mAttribNumber = cMeshUtil::eAttributePosition;
-	attr_info.mAttribSize = sizeof(pos_data[0]);
-	attr_info.mDataOffset = 0;
-	attr_info.mDataStride = 0;
-	attr_info.mNumComp = cMeshUtil::gPosDim;
-	gCylinderMesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_len, (GLubyte*)pos_data, 0, 1, &attr_info);
-
+	PushMatrix();
+	Scale(tVector(r, h, r, 1));
 	gCylinderMesh->Draw(gl_mode);
+	PopMatrix();
 }
 
 void cDrawUtil::DrawPlane(const tVector& coeffs, double size, eDrawMode draw_mode)
@@ -434,6 +385,28 @@ void cDrawUtil::DrawArrow2D(const tVector& start, const tVector& end, double hea
 	}
 }
 
+void cDrawUtil::DrawInstances(cDrawMesh& mesh, const tMatrixArr& transforms, const tVectorArr& colors, eDrawMode draw_mode)
+{
+	assert(transforms.size() == colors.size());
+	GLenum gl_mode = (draw_mode == eDrawWire) ? GL_LINES : GL_TRIANGLES;
+	int num_instances = static_cast<int>(transforms.size());
+
+	gInstanceData.resize(num_instances * cDrawMesh::gInstanceSize);
+	for (int i = 0; i < num_instances; ++i)
+	{
+		PackInstance(transforms[i], colors[i], gInstanceData.data() + i * cDrawMesh::gInstanceSize);
+	}
+	mesh.DrawInstances(num_instances, gInstanceData.data(), gl_mode);
+}
+
+void cDrawUtil::PackInstance(const tMatrix& trans, const tVector& col, float* out_data)
+{
+	Eigen::Map<Eigen::Matrix4f> out_trans(out_data);
+	Eigen::Map<Eigen::Vector4f> out_col(out_data + out_trans.size());
+	out_trans = trans.cast<float>();
+	out_col = col.cast<float>();
+}
+
 void cDrawUtil::ClearColor(const tVector& col)
 {
 	glClearColor(static_cast<float>(col[0]), static_cast<float>(col[1]),
@@ -503,11 +476,13 @@ void cDrawUtil::BuildMeshes()
 	cMeshUtil::BuildPointMesh(gPointMesh);
 	cMeshUtil::BuildLineMesh(gLineMesh);
 	cMeshUtil::BuildQuadMesh(gQuadMesh);
+	cMeshUtil::BuildQuadMesh(gDynamicQuadMesh);
 	cMeshUtil::BuildBoxMesh(gBoxMesh);
 	cMeshUtil::BuildSphereMesh(gNumStacks, gNumSlice, gSphereMesh);
 	cMeshUtil::BuildDiskMesh(gDiskSlices, gDiskMesh);
 	cMeshUtil::BuildTriangleMesh(gTriangleMesh);
 	cMeshUtil::BuildCylinder(gNumSlice, gCylinderMesh);
+	cMeshUtil::BuildLineMesh(gDeferredMesh);
 }
 
 void cDrawUtil::BindShader(cShader* shader)
@@ -547,14 +522,178 @@ void cDrawUtil::SetColor(const tVector& col)
 
 void cDrawUtil::SetLineWidth(double w)
 {
+	gLineWidth = w;
 	glLineWidth(static_cast<float>(w));
 }
 
 void cDrawUtil::SetPointSize(double pt_size)
 {
+	gPointSize = pt_size;
 	glPointSize(static_cast<float>(pt_size));
 }
 
+tVector cDrawUtil::CalcQuadNormal(const tVector& a, const tVector& b, const tVector& d)
+{
+	tVector normal = (b - a).cross3(d - a);
+	double normal_len = normal.norm();
+	if (normal_len == 0)
+	{
+		normal = tVector(0, 0, 1, 0);
+	}
+	else
+	{
+		normal = (normal / normal_len);
+	}
+	return normal;
+}
+
+void cDrawUtil::SubmitMesh(cDrawMesh& mesh, GLenum primitive)
+{
+	if (gDeferred)
+	{
+		tDrawCmd cmd;
+		cmd.mMesh = &mesh;
+		cmd.mPrimitive = primitive;
+		cmd.mShader = gShader;
+		cmd.mTrans = GetModelViewMatrix();
+		cmd.mColor = gColor;
+		cmd.mSize = (primitive == GL_POINTS) ? gPointSize : gLineWidth;
+		gDrawCmds.push_back(cmd);
+	}
+	else
+	{
+		mesh.Draw(primitive);
+	}
+}
+
+bool cDrawUtil::IsVertexCmd(const tDrawCmd& cmd)
+{
+	// lines and points are merged into the deferred mesh instead of being drawn as instances
+	return cmd.mMesh == gLineMesh.get() || cmd.mMesh == gPointMesh.get();
+}
+
+bool cDrawUtil::CompareDrawCmds(const tDrawCmd& a, const tDrawCmd& b)
+{
+	if (a.mShader != b.mShader)
+	{
+		return a.mShader < b.mShader;
+	}
+	if (a.mMesh != b.mMesh)
+	{
+		return a.mMesh < b.mMesh;
+	}
+	if (a.mPrimitive != b.mPrimitive)
+	{
+		return a.mPrimitive < b.mPrimitive;
+	}
+	if (a.mSize != b.mSize)
+	{
+		return a.mSize < b.mSize;
+	}
+	for (int i = 0; i < a.mColor.size(); ++i)
+	{
+		if (a.mColor[i] != b.mColor[i])
+		{
+			return a.mColor[i] < b.mColor[i];
+		}
+	}
+	return false;
+}
+
+bool cDrawUtil::SameDrawRun(const tDrawCmd& a, const tDrawCmd& b)
+{
+	// instances can differ in color, merged lines and points share a single color and size
+	bool same = a.mShader == b.mShader && a.mMesh == b.mMesh && a.mPrimitive == b.mPrimitive;
+	if (same && (IsVertexCmd(a) || gInstanceShader == nullptr))
+	{
+		same = a.mSize == b.mSize && a.mColor == b.mColor;
+	}
+	return same;
+}
+
+void cDrawUtil::BuildDeferredMesh()
+{
+	// vertices of the recorded lines and points in the order of the sorted commands,
+	// positions and normals are transformed by the recorded matrices
+	const tVector line_end = tVector(1, 0, 0, 1);
+	const tVector origin = tVector(0, 0, 0, 1);
+	const tVector normal = tVector(0, 0, 1, 0);
+
+	gDeferredPos.clear();
+	gDeferredNorm.clear();
+	for (size_t i = 0; i < gDrawCmds.size(); ++i)
+	{
+		const tDrawCmd& cmd = gDrawCmds[i];
+		if (IsVertexCmd(cmd))
+		{
+			int num_verts = (cmd.mMesh == gLineMesh.get()) ? 2 : 1;
+			tVector n = cmd.mTrans * normal;
+			for (int v = 0; v < num_verts; ++v)
+			{
+				tVector p = cmd.mTrans * ((v == 0) ? origin : line_end);
+				gDeferredPos.insert(gDeferredPos.end(), { static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]) });
+				gDeferredNorm.insert(gDeferredNorm.end(), { static_cast<float>(n[0]), static_cast<float>(n[1]), static_cast<float>(n[2]) });
+			}
+		}
+	}
+
+	// texture coordinates and indices never change, so they are only loaded when the mesh has to grow
+	cMeshUtil::LoadLineMesh(gDeferredPos.data(), static_cast<int>(gDeferredPos.size()), gDeferredNorm.data(),
+							gDeferredCapacity, gDeferredMesh.get());
+}
+
+void cDrawUtil::FlushDrawRun(int cmd_beg, int cmd_end, int& vert_offset)
+{
+	const tDrawCmd& first_cmd = gDrawCmds[cmd_beg];
+	int num_cmds = cmd_end - cmd_beg;
+
+	if (IsVertexCmd(first_cmd))
+	{
+		int num_verts = num_cmds * ((first_cmd.mMesh == gLineMesh.get()) ? 2 : 1);
+		if (first_cmd.mShader != nullptr)
+		{
+			BindShader(first_cmd.mShader);
+		}
+		SetColor(first_cmd.mColor);
+		if (first_cmd.mPrimitive == GL_POINTS)
+		{
+			glPointSize(static_cast<float>(first_cmd.mSize));
+		}
+		else
+		{
+			glLineWidth(static_cast<float>(first_cmd.mSize));
+		}
+		gDeferredMesh->Draw(first_cmd.mPrimitive, vert_offset, num_verts);
+		vert_offset += num_verts;
+	}
+	else if (gInstanceShader != nullptr)
+	{
+		gInstanceData.resize(num_cmds * cDrawMesh::gInstanceSize);
+		for (int i = 0; i < num_cmds; ++i)
+		{
+			const tDrawCmd& cmd = gDrawCmds[cmd_beg + i];
+			PackInstance(cmd.mTrans, cmd.mColor, gInstanceData.data() + i * cDrawMesh::gInstanceSize);
+		}
+		BindShader(gInstanceShader);
+		first_cmd.mMesh->DrawInstances(num_cmds, gInstanceData.data(), first_cmd.mPrimitive);
+	}
+	else
+	{
+		if (first_cmd.mShader != nullptr)
+		{
+			BindShader(first_cmd.mShader);
+		}
+		SetColor(first_cmd.mColor);
+		glLineWidth(static_cast<float>(first_cmd.mSize));
+		for (int i = cmd_beg; i < cmd_end; ++i)
+		{
+			SetMatrix(gDrawCmds[i].mTrans);
+			gDrawCmds[i].mMesh->Draw(gDrawCmds[i].mPrimitive);
+		}
+		LoadIdentityMatrix();
+	}
+}
+
 std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>>& cDrawUtil::GetCurrMatrixStack()
 {
 	if (mMatrixMode == eMatrixModeProj)
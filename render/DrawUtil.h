@@ -26,6 +26,15 @@ public:
 	};
 
 	static void InitDrawUtil();
+
+	// in deferred mode DrawBox, DrawSphere, DrawLine and DrawPoint only record the call along with the
+	// current matrix, color and shader, and FlushDeferred draws everything recorded since BeginDeferred.
+	// Identical primitives are drawn as instances with instance_shader, which has to be built from
+	// Mesh_Instanced_VS.glsl and have the same lighting as the regular shader, and all lines and points
+	// are merged into one vertex buffer. Without an instance shader each primitive is still drawn on its own
+	static void BeginDeferred(cShader* instance_shader = nullptr);
+	static void FlushDeferred();
+	static bool IsDeferred();
 	static void DrawRect(const tVector& pos, const tVector& size, eDrawMode draw_mode = eDrawSolid);
 	static void DrawBox(const tVector& pos, const tVector& size, eDrawMode draw_mode = eDrawSolid);
 	static void DrawTriangle(const tVector& pos, double side_len, eDrawMode draw_mode = eDrawSolid);
@@ -46,6 +55,11 @@ public:
 
 	static void DrawArrow2D(const tVector& start, const tVector& end, double head_size);
 
+	// draws every instance of a mesh with one draw call, requires a shader built from Mesh_Instanced_VS.glsl,
+	// the transforms are applied on top of the current model view matrix
+	static void DrawInstances(cDrawMesh& mesh, const tMatrixArr& transforms, const tVectorArr& colors, eDrawMode draw_mode = eDrawSolid);
+	static void PackInstance(const tMatrix& trans, const tVector& col, float* out_data);
+
 	static void ClearColor(const tVector& col);
 	static void ClearDepth(double depth);
 
@@ -74,20 +88,53 @@ public:
 	static void SyncMatrices();
 
 protected:
+	// a draw call recorded in deferred mode
+	struct tDrawCmd
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		cDrawMesh* mMesh;
+		GLenum mPrimitive;
+		cShader* mShader;
+		tMatrix mTrans; // model view matrix at the time of the call
+		tVector mColor;
+		double mSize; // point size for points, line width for everything else
+	};
+
 	static tVector gColor;
 	static cShader* gShader;
+	static double gLineWidth;
+	static double gPointSize;
+
+	static bool gDeferred;
+	static cShader* gInstanceShader;
+	static std::vector<tDrawCmd, Eigen::aligned_allocator<tDrawCmd>> gDrawCmds;
+	static std::unique_ptr<cDrawMesh> gDeferredMesh; // lines and points of the current flush
+	static std::vector<float> gDeferredPos;
+	static std::vector<float> gDeferredNorm;
+	static int gDeferredCapacity; // vertices the texture coordinates and indices of the deferred mesh were loaded for
 
 	static std::unique_ptr<cDrawMesh> gPointMesh;
 	static std::unique_ptr<cDrawMesh> gLineMesh;
 	static std::unique_ptr<cDrawMesh> gQuadMesh;
+	static std::unique_ptr<cDrawMesh> gDynamicQuadMesh; // rebuilt by every quad that is not a transformed unit quad
 	static std::unique_ptr<cDrawMesh> gBoxMesh;
 	static std::unique_ptr<cDrawMesh> gSphereMesh;
 	static std::unique_ptr<cDrawMesh> gDiskMesh;
 	static std::unique_ptr<cDrawMesh> gTriangleMesh;
 	static std::unique_ptr<cDrawMesh> gCylinderMesh;
+	static std::vector<float> gInstanceData;
 
 	static eMatrixMode mMatrixMode;
 	static std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mMatrixStackProj;
 	static std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mMatrixStackModelView;
 	static std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>>& GetCurrMatrixStack();
+	static tVector CalcQuadNormal(const tVector& a, const tVector& b, const tVector& d);
+
+	static void SubmitMesh(cDrawMesh& mesh, GLenum primitive);
+	static bool IsVertexCmd(const tDrawCmd& cmd);
+	static bool CompareDrawCmds(const tDrawCmd& a, const tDrawCmd& b);
+	static bool SameDrawRun(const tDrawCmd& a, const tDrawCmd& b);
+	static void BuildDeferredMesh();
+	static void FlushDrawRun(int cmd_beg, int cmd_end, int& vert_offset);
 };
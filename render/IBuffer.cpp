@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <cstdio>
+#include <algorithm>
 
 void cIBuffer::ResizeBuffer(int size)
 {
@@ -33,6 +34,7 @@ void cIBuffer::ResizeBuffer(int size)
 
     mLocalData = tmp;
     mSize = size;
+    MarkDirty(0, mSize);
 
     if (!mLocalData)
     {
@@ -48,6 +50,7 @@ void cIBuffer::LoadBuffer(int num_elem, int elem_size, int *data, int data_offse
     mElemSize = elem_size;
     ResizeBuffer(num_elem * elem_size + data_offset); // does nothing if data is already allocated and large enough
     memcpy(mLocalData, data, num_elem * elem_size);     // note: don't use mSize. This method allows partial copies
+    MarkDirty(0, num_elem * elem_size);
 
 #ifdef DEBUG
     GLenum err =  glGetError();
@@ -62,8 +65,36 @@ void cIBuffer::LoadBuffer(int num_elem, int elem_size, int *data, int data_offse
 // \param specify a buffer other than the stored buffer to allocate to
 void cIBuffer::SyncBuffer(GLuint buffer)
 {
+    if (!IsDirty())
+        return;
+
+    // the index buffer binding is part of the VAO, so it only needs to be set along with the first upload
     mRenderState->BindIBO(buffer);
-    mRenderState->SetBufferData(buffer, mSize, (unsigned char *)mLocalData);
+    mRenderState->SetBufferSubData(buffer, mSize, mDirtyBeg, mDirtyEnd - mDirtyBeg, (unsigned char *)mLocalData);
+    ClearDirty();
+}
+
+void cIBuffer::MarkDirty(int beg, int end)
+{
+    if (end <= beg)
+        return;
+
+    if (mDirtyEnd > mDirtyBeg)
+    {
+        mDirtyBeg = std::min(mDirtyBeg, beg);
+        mDirtyEnd = std::max(mDirtyEnd, end);
+    }
+    else
+    {
+        mDirtyBeg = beg;
+        mDirtyEnd = end;
+    }
+}
+
+void cIBuffer::ClearDirty()
+{
+    mDirtyBeg = 0;
+    mDirtyEnd = 0;
 }
 
 int cIBuffer::GetNumElems() const
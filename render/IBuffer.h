@@ -30,9 +30,10 @@ class PLUGIN_EXPORT cIBuffer
 public:
     // takes in its index within the mesh that owns it
     // this is used to keep track of attrib array number
-	cIBuffer(): mRenderID(0), mRenderState(NULL), mLocalData(NULL), mElemSize(0), mSize(0)
+	cIBuffer(): mRenderID(0), mRenderState(NULL), mLocalData(NULL), mElemSize(0), mSize(0), mDirtyBeg(0), mDirtyEnd(0)
     {}
-	cIBuffer(GLuint bufferID, cRenderState &r_state): mRenderID(bufferID), mRenderState(&r_state), mLocalData(NULL), mElemSize(0), mSize(0)
+	cIBuffer(GLuint bufferID, cRenderState &r_state): mRenderID(bufferID), mRenderState(&r_state), mLocalData(NULL), mElemSize(0), mSize(0),
+                                                      mDirtyBeg(0), mDirtyEnd(0)
     {}
     ~cIBuffer()
     {
@@ -47,14 +48,22 @@ public:
     }
     void ResizeBuffer(int size);
     void LoadBuffer(int num_elem, int elem_size, int *data, int offset=0);
+    // only the bytes changed since the last sync are sent, and nothing at all if the buffer is clean
     void SyncBuffer();
     void SyncBuffer(GLuint buffer);
 	int GetNumElems() const;
 
+    bool IsDirty() const { return mDirtyEnd > mDirtyBeg; }
+    void MarkDirty(int beg, int end); // marks bytes [beg, end) as changed
+    void ClearDirty();
+
     int          mSize;        // the size in BYTEs of our local data store
     int          mElemSize;   // the size of an individual index
     GLubyte     *mLocalData;     // our local copy of the mesh data that we can modify and copy to the gpu
 
     GLuint       mRenderID;
     cRenderState *mRenderState;
+
+    int          mDirtyBeg;    // byte range of the local data that has changed since the last sync
+    int          mDirtyEnd;
 };
@@ -295,6 +295,59 @@ void cMeshUtil::BuildLineMesh(std::unique_ptr<cDrawMesh>& out_mesh)
 	BuildDrawMesh(vert_data, pos_len, norm_data, norm_len, coord_data, coord_len, idx_data, idx_len, out_mesh.get());
 }
 
+void cMeshUtil::LoadLineMesh(const float* pos_data, int pos_size, const float* norm_data, int& in_out_capacity,
+							cDrawMesh* out_mesh)
+{
+	int num_verts = pos_size / gPosDim;
+	if (num_verts == 0)
+	{
+		return;
+	}
+
+	tAttribInfo attr_info;
+	attr_info.mAttribNumber = eAttributePosition;
+	attr_info.mAttribSize = sizeof(float);
+	attr_info.mDataOffset = 0;
+	attr_info.mDataStride = 0;
+	attr_info.mNumComp = gPosDim;
+	out_mesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * pos_size, (GLubyte*)pos_data, 0, 1, &attr_info);
+
+	attr_info.mAttribNumber = eAttributeNormal;
+	attr_info.mNumComp = gNormDim;
+	if (norm_data != nullptr)
+	{
+		out_mesh->LoadVBuffer(attr_info.mAttribNumber, sizeof(float) * num_verts * gNormDim, (GLubyte*)norm_data, 0, 1, &attr_info);
+	}
+
+	if (num_verts > in_out_capacity)
+	{
+		std::vector<float> coord_data(num_verts * gCoordDim, 0);
+		std::vector<int> idx_data(num_verts);
+		for (int i = 0; i < num_verts; ++i)
+		{
+			idx_data[i] = i;
+		}
+
+		if (norm_data == nullptr)
+		{
+			std::vector<float> z_norm_data(num_verts * gNormDim, 0);
+			for (int i = 0; i < num_verts; ++i)
+			{
+				z_norm_data[i * gNormDim + 2] = 1;
+			}
+			out_mesh->LoadVBuffer(attr_info.mAttribNumber, static_cast<int>(sizeof(float) * z_norm_data.size()),
+								(GLubyte*)z_norm_data.data(), 0, 1, &attr_info);
+		}
+
+		attr_info.mAttribNumber = eAttributeCoord;
+		attr_info.mNumComp = gCoordDim;
+		out_mesh->LoadVBuffer(attr_info.mAttribNumber, static_cast<int>(sizeof(float) * coord_data.size()),
+							(GLubyte*)coord_data.data(), 0, 1, &attr_info);
+		out_mesh->LoadIBuffer(num_verts, sizeof(int), idx_data.data());
+		in_out_capacity = num_verts;
+	}
+}
+
 void cMeshUtil::BuildQuadMesh(std::unique_ptr<cDrawMesh>& out_mesh)
 {
 	const int num_verts = 4;
@@ -56,6 +56,11 @@ public:
 
 	static void BuildPointMesh(std::unique_ptr<cDrawMesh>& out_mesh);
 	static void BuildLineMesh(std::unique_ptr<cDrawMesh>& out_mesh);
+	// loads new vertices into an existing mesh for drawing points, lines or line strips, the texture coordinates
+	// and indices are only loaded when the mesh grows past in_out_capacity vertices, the normals face along z
+	// like the unit line and are only loaded with them unless norm_data is given, which is loaded every time
+	static void LoadLineMesh(const float* pos_data, int pos_size, const float* norm_data, int& in_out_capacity,
+							cDrawMesh* out_mesh);
 	static void BuildQuadMesh(std::unique_ptr<cDrawMesh>& out_mesh);
 	static void BuildBoxMesh(std::unique_ptr<cDrawMesh>& out_mesh);
 	static void BuildSphereMesh(int stacks, int slices, std::unique_ptr<cDrawMesh>& out_mesh);
@@ -78,6 +78,20 @@ public:
         else
             glBufferSubData(GL_ARRAY_BUFFER, 0, num_bytes, data);
     }
+
+    // uploads bytes [offset, offset + num_bytes) of a buffer holding total_bytes,
+    // data points to the start of the buffer. The whole buffer is sent if the GPU copy is too small
+    void SetBufferSubData(unsigned int i, std::size_t total_bytes, std::size_t offset, std::size_t num_bytes, unsigned char *data)
+    {
+        BindVBO(i);
+        if (mBytes[i] < total_bytes)
+        {
+            mBytes[i] = static_cast<unsigned int>(total_bytes);
+            glBufferData(GL_ARRAY_BUFFER, total_bytes, data, GL_STATIC_DRAW);
+        }
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, offset, num_bytes, data + offset);
+    }
     void SetAttributeData(tAttribInfo &info)
     { SetAttributeData(info.mAttribNumber, info.mNumComp, info.mDataOffset, info.mDataStride); }
 
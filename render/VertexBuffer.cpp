@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "render/VertexBuffer.h"
 
 
@@ -37,6 +38,7 @@ void cVertexBuffer::ResizeBuffer(int size)
 
     // nothing is actually loaded to the GPU until draw time to
     // avoid redundant updates
+    MarkDirty(0, mSize);
 }
 
 /* Each vertex has a set of attributes (such as position, normals, texture coords, etc)
@@ -79,16 +81,21 @@ void cVertexBuffer::LoadBuffer(int data_size, GLubyte *data, int data_offset, in
         delete [] mAttrInfo;
         mAttrInfo = NULL;
     }
-    mNumAttr = num_attr;
 
     if (!mAttrInfo)
+    {
         mAttrInfo = new tAttribInfo[num_attr];
+        mAttrDirty = true;
+    }
 
-    // update our internal attribute info
+    // update our internal attribute info, the attribute pointers are only set again if the layout changed
+    mAttrDirty |= mNumAttr != num_attr || memcmp(mAttrInfo, attr_info, num_attr * sizeof(tAttribInfo)) != 0;
+    mNumAttr = num_attr;
     memcpy(mAttrInfo, attr_info, num_attr * sizeof(tAttribInfo));
 
-    // update our internal data
-    memcpy(mLocalData + data_offset, data, data_size);
+    // update our internal data, data_offset is in bytes
+    memcpy(reinterpret_cast<GLubyte*>(mLocalData) + data_offset, data, data_size);
+    MarkDirty(data_offset, data_offset + data_size);
 
 #ifdef DEBUG
     GLenum err =  glGetError();
@@ -99,14 +106,49 @@ void cVertexBuffer::LoadBuffer(int data_size, GLubyte *data, int data_offset, in
 #endif
 }
 
-// copy all local data to the GPU
+// copy the changed local data to the GPU
 // \param specify a buffer other than the stored buffer to allocate to
 void cVertexBuffer::SyncBuffer(GLuint buffer)
 {
-    mRenderState->SetBufferData(buffer, mSize, (unsigned char *)mLocalData);
+    if (!IsDirty())
+        return;
+
+    if (mDirtyEnd > mDirtyBeg)
+        mRenderState->SetBufferSubData(buffer, mSize, mDirtyBeg, mDirtyEnd - mDirtyBeg, (unsigned char *)mLocalData);
+
+    if (mAttrDirty)
+    {
+        // attribute pointers refer to the buffer bound to GL_ARRAY_BUFFER
+        mRenderState->BindVBO(buffer);
+        for (int i = 0; i < mNumAttr; ++i)
+            mRenderState->SetAttributeData(mAttrInfo[i]);
+    }
+
+    ClearDirty();
+}
 
-    for (int i = 0; i < mNumAttr; ++i)
-        mRenderState->SetAttributeData(mAttrInfo[i]);
+void cVertexBuffer::MarkDirty(int beg, int end)
+{
+    if (end <= beg)
+        return;
+
+    if (mDirtyEnd > mDirtyBeg)
+    {
+        mDirtyBeg = std::min(mDirtyBeg, beg);
+        mDirtyEnd = std::max(mDirtyEnd, end);
+    }
+    else
+    {
+        mDirtyBeg = beg;
+        mDirtyEnd = end;
+    }
+}
+
+void cVertexBuffer::ClearDirty()
+{
+    mDirtyBeg = 0;
+    mDirtyEnd = 0;
+    mAttrDirty = false;
 }
 
 // copy all local data to the GPU using
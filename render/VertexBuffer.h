@@ -19,18 +19,22 @@ public:
     // inherently delete the gl id its working with)
 
 	cVertexBuffer():mRenderID(0), mRenderState(NULL), mLocalData(NULL),
-              mAttrInfo(NULL), mNumAttr(0), mSize(0)
+              mAttrInfo(NULL), mNumAttr(0), mSize(0), mDirtyBeg(0), mDirtyEnd(0), mAttrDirty(false)
     {}
 	cVertexBuffer(GLuint bufferID, cRenderState &r_state):mRenderID(bufferID), mRenderState(&r_state), mLocalData(NULL),
-                                       mAttrInfo(NULL), mNumAttr(0), mSize(0)
+                                       mAttrInfo(NULL), mNumAttr(0), mSize(0), mDirtyBeg(0), mDirtyEnd(0), mAttrDirty(false)
     {}
 	cVertexBuffer(const cVertexBuffer &old): mRenderID(old.mRenderID), mRenderState(old.mRenderState), mNumAttr(old.mNumAttr),
-                           mSize(old.mSize) {
+                           mSize(old.mSize), mDirtyBeg(0), mDirtyEnd(0), mAttrDirty(false) {
         mLocalData = (float*) new char[mSize];
         memcpy(mLocalData, old.mLocalData, mSize);
 
         mAttrInfo = new tAttribInfo[mNumAttr];
         memcpy(mAttrInfo, old.mAttrInfo, sizeof(tAttribInfo)*mNumAttr);
+
+        // the copy has not been sent anywhere yet
+        MarkDirty(0, mSize);
+        mAttrDirty = mNumAttr > 0;
     }
 
     ~cVertexBuffer()
@@ -52,10 +56,15 @@ public:
     // buffer object has no notion of VAO it is just setting its parameters on whatever
     // VAO is currently bound
     void LoadBuffer(int data_size, GLubyte *data, int data_offset, int num_attr, tAttribInfo *attr_info);
+    // only the bytes changed since the last sync are sent, and nothing at all if the buffer is clean
     void SyncBuffer();
     void SyncBuffer(GLuint buffer);
     void SyncBuffer(GLuint buffer, GLuint *size);
 
+    bool IsDirty() const { return mDirtyEnd > mDirtyBeg || mAttrDirty; }
+    void MarkDirty(int beg, int end); // marks bytes [beg, end) as changed
+    void ClearDirty();
+
     int          mSize;           // the size in BYTEs of our local data store
     int          mNumAttr;       // the number of attributes per vertex
 	tAttribInfo *mAttrInfo;
@@ -64,4 +73,8 @@ public:
 
     GLuint       mRenderID;
     cRenderState *mRenderState;
+
+    int          mDirtyBeg;      // byte range of the local data that has changed since the last sync
+    int          mDirtyEnd;
+    bool         mAttrDirty;     // the attribute layout has to be specified again
 };
@@ -4,8 +4,15 @@
 
 #include "render/OBJParser.h"
 
+// every scenario bakes its clip at the same rate and budget, so that scenarios playing the same file share a cache
+const double gPoseCacheRate = 120;
+const size_t gPoseCacheBudget = 16 << 20; // bytes
+
 cBipedScenario::cBipedScenario()
 {
+	mCursor.SetCurve(&mCurve);
+	mPoseSource = ePoseSourceCurve;
+
 	// new curve parameter files can be added here
 	mParamFiles.push_back("data/char_params/biped_walk.txt");
 	mParamFiles.push_back("data/char_params/biped_inplace_walk.txt");
@@ -14,6 +21,7 @@ cBipedScenario::cBipedScenario()
 cBipedScenario::~cBipedScenario()
 {
 	mShader.free();
+	mInstanceShader.free();
 }
 
 void cBipedScenario::Init()
@@ -28,6 +36,7 @@ void cBipedScenario::Init()
 	
 	BuildCharacter(mChar);
 	mChar->Init();
+	BuildPoseCurve();
 }
 
 void cBipedScenario::Update(double time_elapsed)
@@ -55,6 +64,35 @@ void cBipedScenario::SetPlaybackProgress(double val)
 	SetTime(time);
 }
 
+void cBipedScenario::SetPoseSource(ePoseSource source)
+{
+	mPoseSource = source;
+	if (mPoseSource == ePoseSourceCache && mPoseCache == nullptr)
+	{
+		BuildPoseCache();
+	}
+}
+
+cBipedScenario::ePoseSource cBipedScenario::GetPoseSource() const
+{
+	return mPoseSource;
+}
+
+bool cBipedScenario::IsPoseSourceSupported(ePoseSource source) const
+{
+	return source >= 0 && source < ePoseSourceMax;
+}
+
+void cBipedScenario::SetRotInterp(cPoseCurve::eRotInterp interp)
+{
+	mPoseCurve.SetRotInterp(interp);
+}
+
+cPoseCurve::eRotInterp cBipedScenario::GetRotInterp() const
+{
+	return mPoseCurve.GetRotInterp();
+}
+
 void cBipedScenario::InitCamera()
 {
 	double h = 4;
@@ -70,6 +108,7 @@ void cBipedScenario::InitCamera()
 void cBipedScenario::LoadShaders()
 {
 	mShader.initFromFiles("a_simple_shader", "data/shaders/Mesh_VS.glsl", "data/shaders/Mesh_PS.glsl");
+	mInstanceShader.initFromFiles("instanced_shader", "data/shaders/Mesh_Instanced_VS.glsl", "data/shaders/Mesh_PS.glsl");
 }
 
 void cBipedScenario::LoadParams(const std::string& param_file)
@@ -78,6 +117,16 @@ void cBipedScenario::LoadParams(const std::string& param_file)
 	if (succ)
 	{
 		printf("Loaded curve from %s\n", param_file.c_str());
+		mParamFile = param_file;
+		mPoseCache.reset();
+		if (mPoseSource == ePoseSourceCache)
+		{
+			BuildPoseCache();
+		}
+		if (mChar != nullptr)
+		{
+			BuildPoseCurve();
+		}
 	}
 	else
 	{
@@ -90,19 +139,56 @@ void cBipedScenario::BuildCharacter(std::unique_ptr<cArticulatedFigure>& out_cha
 	out_char = std::unique_ptr<cArticulatedFigure>(new cArticulatedFigure());
 }
 
-void cBipedScenario::UpdateCharacter()
+void cBipedScenario::BuildPoseCurve()
 {
-	double max_time = mCurve.GetMaxTime();
-	double curr_time = mTime;
-	curr_time = std::fmod(curr_time, max_time);
-	if (curr_time < 0)
+	// the Euler angles of the clip are converted to quaternions once here instead of every frame
+	bool succ = mPoseCurve.Init(mCurve, *mChar);
+	if (!succ)
+	{
+		mPoseCurve.Clear();
+	}
+}
+
+void cBipedScenario::BuildPoseCache()
+{
+	// the biped has no threads of its own, so a pool is only started while the clip is baked
+	cThreadPool pool;
+	pool.Init();
+	BakePoseCache(&pool);
+}
+
+void cBipedScenario::BakePoseCache(cThreadPool* pool)
+{
+	// the clip is baked once and then shared with every other scenario playing the same file
+	mPoseCache = cPoseCache::Load(mParamFile, mCurve, gPoseCacheRate, gPoseCacheBudget, pool);
+	if (mPoseCache != nullptr)
 	{
-		curr_time += max_time;
+		printf("Pose cache with %i frames at %.1f Hz, %.1f KB\n", mPoseCache->GetNumFrames(),
+				mPoseCache->GetFrameRate(), mPoseCache->GetMemSize() / 1024.0);
 	}
+}
 
-	Eigen::VectorXd pose;
-	mCurve.Eval(curr_time, pose);
-	mChar->SetPose(pose);
+void cBipedScenario::UpdateCharacter()
+{
+	// the cursor wraps the time around the end of the clip
+	mCursor.SetTime(mTime);
+	if (mPoseSource == ePoseSourceQuat && mPoseCurve.GetNumKeys() > 1)
+	{
+		mPoseCurve.Eval(mCursor.GetTime(), mQuatPose);
+		mChar->SetPose(mQuatPose);
+	}
+	else if (mPoseSource == ePoseSourceCache && mPoseCache != nullptr)
+	{
+		Eigen::VectorXd pose;
+		mPoseCache->Eval(mCursor.GetTime(), pose);
+		mChar->SetPose(pose);
+	}
+	else
+	{
+		Eigen::VectorXd pose;
+		mCursor.Eval(pose);
+		mChar->SetPose(pose);
+	}
 }
 
 void cBipedScenario::SetColor(const tVector& col)
@@ -119,18 +205,30 @@ void cBipedScenario::SetupDraw()
 
 void cBipedScenario::SetupShader()
 {
+	mInstanceShader.Bind();
+	SetLightUniforms(mInstanceShader);
+	mShader.Bind();
+	SetLightUniforms(mShader);
+}
+
+void cBipedScenario::SetLightUniforms(cShader& shader)
+{
+	// the shader has to be bound
 	tVector light_dir = tVector(0.1, 1, 0.5, 0).normalized();
 	const tVector light_col = tVector(0.5, 0.5, 0.5, 0);
 	const tVector ambient_col = tVector(0.5, 0.5, 0.5, 0);
 
-	mShader.Bind();
-
 	tMatrix view_mat = mCamera.BuildWorldViewMatrix();
 	light_dir = view_mat * light_dir;
 
-	mShader.setUniform("gLightDir", Eigen::Vector3f(light_dir[0], light_dir[1], light_dir[2]));
-	mShader.setUniform("gLightColour", Eigen::Vector3f(light_col[0], light_col[1], light_col[2]));
-	mShader.setUniform("gAmbientColour", Eigen::Vector3f(ambient_col[0], ambient_col[1], ambient_col[2]));
+	shader.setUniform("gLightDir", Eigen::Vector3f(light_dir[0], light_dir[1], light_dir[2]));
+	shader.setUniform("gLightColour", Eigen::Vector3f(light_col[0], light_col[1], light_col[2]));
+	shader.setUniform("gAmbientColour", Eigen::Vector3f(ambient_col[0], ambient_col[1], ambient_col[2]));
+}
+
+cShader* cBipedScenario::GetInstanceShader()
+{
+	return &mInstanceShader;
 }
 
 void cBipedScenario::DrawScene()
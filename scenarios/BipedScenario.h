@@ -3,6 +3,9 @@
 #include <nanogui/glutil.h>
 #include "scenarios/Scenario.h"
 #include "Curve.h"
+#include "CurveCursor.h"
+#include "PoseCurve.h"
+#include "PoseCache.h"
 #include "render/Shader.h"
 #include "ArticulatedFigure.h"
 
@@ -13,6 +16,14 @@ class PLUGIN_EXPORT cBipedScenario : public cScenario
 public:
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+	enum ePoseSource
+	{
+		ePoseSourceCurve, // evaluates the Euler angle curve
+		ePoseSourceQuat, // interpolates quaternion keys built from the anchors of the curve
+		ePoseSourceCache, // blends frames baked from the curve at a fixed rate
+		ePoseSourceMax
+	};
+
 	cBipedScenario();
 	virtual ~cBipedScenario();
 
@@ -23,11 +34,26 @@ public:
 
 	virtual double GetPlaybackProgress() const;
 	virtual void SetPlaybackProgress(double val);
+
+	virtual void SetPoseSource(ePoseSource source);
+	virtual ePoseSource GetPoseSource() const;
+	virtual bool IsPoseSourceSupported(ePoseSource source) const;
+	// interpolation of the quaternion keys used by ePoseSourceQuat
+	virtual void SetRotInterp(cPoseCurve::eRotInterp interp);
+	virtual cPoseCurve::eRotInterp GetRotInterp() const;
 	
 protected:
 	
 	cShader mShader;
+	cShader mInstanceShader;
 	cCurve mCurve;
+	cCurveCursor mCursor;
+	std::string mParamFile;
+
+	ePoseSource mPoseSource;
+	cPoseCurve mPoseCurve;
+	cArticulatedFigure::tQuatPose mQuatPose;
+	std::shared_ptr<const cPoseCache> mPoseCache; // only baked once the cache is picked as the pose source
 
 	std::unique_ptr<cArticulatedFigure> mChar;
 
@@ -35,12 +61,17 @@ protected:
 
 	virtual void LoadShaders();
 	virtual void BuildCharacter(std::unique_ptr<cArticulatedFigure>& out_char) const;
+	virtual void BuildPoseCurve();
+	virtual void BuildPoseCache();
+	virtual void BakePoseCache(cThreadPool* pool);
 	virtual void UpdateCharacter();
 
 	virtual void SetColor(const tVector& col);
 
 	virtual void SetupDraw();
 	virtual void SetupShader();
+	virtual void SetLightUniforms(cShader& shader);
+	virtual cShader* GetInstanceShader();
 
 	virtual void DrawScene();
 	virtual void DrawGround();
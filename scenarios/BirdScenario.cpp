@@ -6,24 +6,35 @@
 
 const double gLineWidth = 1;
 const double gPointSize = 10;
-const int gSegmentSamples = 20;
+const double gCurveTessErr = 0.001; // max deviation of the drawn curve from the true curve
+
+cBirdScenario::tLineMesh::tLineMesh()
+{
+	mNumVerts = 0;
+	mCapacity = 0;
+}
 
 cBirdScenario::cBirdScenario()
 {
+	mCursor.SetCurve(&mCurve);
+
 	// new curve parameter files can be added here
 	mParamFiles.push_back("data/curve_params/catmull_rom.txt");
 	mParamFiles.push_back("data/curve_params/b_spline.txt");
+	mParamFiles.push_back("data/curve_params/catmull_rom_timed.txt");
 }
 
 cBirdScenario::~cBirdScenario()
 {
 	mShader.free();
+	mInstanceShader.free();
 }
 
 void cBirdScenario::Init()
 {
 	cScenario::Init();
 	LoadShaders();
+	BuildCurveMeshes();
 
 	if (mParamFiles.size() > 0)
 	{
@@ -66,12 +77,13 @@ int cBirdScenario::GetNumAnchors() const
 
 int cBirdScenario::GetNumCurveSamples() const
 {
-	return GetNumAnchors() * gSegmentSamples;
+	return static_cast<int>(mCurveSamples.cols());
 }
 
 void cBirdScenario::LoadShaders()
 {
 	mShader.initFromFiles("a_simple_shader", "data/shaders/Mesh_VS.glsl", "data/shaders/Mesh_PS.glsl");
+	mInstanceShader.initFromFiles("instanced_shader", "data/shaders/Mesh_Instanced_VS.glsl", "data/shaders/Mesh_PS.glsl");
 }
 
 int cBirdScenario::GetVertBufferSize() const
@@ -110,20 +122,64 @@ void cBirdScenario::LoadParams(const std::string& param_file)
 
 void cBirdScenario::UpdateCurve()
 {
-	int num_curve_samples = GetNumCurveSamples();
-	double max_time = mCurve.GetMaxTime();
-	mCurveSamples.resize(3, num_curve_samples);
+	// the number of samples adapts to how much each segment bends
+	mCurve.Tessellate(gCurveTessErr, mCurveSamples);
+	assert(mCurveSamples.rows() == 3);
+	UpdateCurveMeshes();
+}
 
-	for (int i = 0; i < num_curve_samples; ++i)
+void cBirdScenario::BuildCurveMeshes()
+{
+	// the meshes start out empty and are filled in once a curve is loaded
+	tLineMesh* meshes[] = { &mCurveMesh, &mAnchorMesh, &mTangentMesh };
+	for (tLineMesh* mesh : meshes)
 	{
-		double t = static_cast<double>(i) / (num_curve_samples - 1);
-		t *= max_time;
-		Eigen::VectorXd pos;
-		mCurve.Eval(t, pos);
-		assert(pos.size() == mCurveSamples.rows());
+		mesh->mMesh = std::unique_ptr<cDrawMesh>(new cDrawMesh());
+		mesh->mMesh->Init(1);
+		mesh->mNumVerts = 0;
+		mesh->mCapacity = 0;
+	}
+}
 
-		mCurveSamples.col(i) = pos;
+void cBirdScenario::UpdateCurveMeshes()
+{
+	std::vector<float> curve_pos(mCurveSamples.data(), mCurveSamples.data() + mCurveSamples.size());
+
+	int num_anchors = mCurve.GetNumAnchors();
+	std::vector<float> anchor_pos;
+	std::vector<float> tangent_pos;
+	anchor_pos.reserve(num_anchors * cMeshUtil::gPosDim);
+	tangent_pos.reserve(2 * num_anchors * cMeshUtil::gPosDim);
+	for (int i = 0; i < num_anchors; ++i)
+	{
+		const auto& pos = mCurve.GetAnchorPos(i);
+		const auto& tangent = mCurve.GetAnchorTangent(i);
+		for (int j = 0; j < cMeshUtil::gPosDim; ++j)
+		{
+			anchor_pos.push_back(static_cast<float>(pos[j]));
+		}
+
+		// each tangent is a separate line from the anchor
+		for (int j = 0; j < cMeshUtil::gPosDim; ++j)
+		{
+			tangent_pos.push_back(static_cast<float>(pos[j]));
+		}
+		for (int j = 0; j < cMeshUtil::gPosDim; ++j)
+		{
+			tangent_pos.push_back(static_cast<float>(pos[j] + tangent[j]));
+		}
 	}
+
+	LoadLineMesh(curve_pos, mCurveMesh);
+	LoadLineMesh(anchor_pos, mAnchorMesh);
+	LoadLineMesh(tangent_pos, mTangentMesh);
+}
+
+void cBirdScenario::LoadLineMesh(const std::vector<float>& pos_data, tLineMesh& out_mesh) const
+{
+	out_mesh.mNumVerts = static_cast<int>(pos_data.size()) / cMeshUtil::gPosDim;
+	cMeshUtil::LoadLineMesh(pos_data.data(), static_cast<int>(pos_data.size()), nullptr, out_mesh.mCapacity,
+							out_mesh.mMesh.get());
 }
 
 void cBirdScenario::UpdateCharacter()
@@ -133,10 +189,9 @@ void cBirdScenario::UpdateCharacter()
 	// moves along the curve and oriented such that it is facing along
 	// the tangent to the curve
 
-	double max_time = mCurve.GetMaxTime();
-	double curr_time = mTime;
-	curr_time = std::fmod(curr_time, max_time);
+	mCursor.SetTime(mTime);
 
+	Eigen::VectorXd pos_data;
 	Eigen::VectorXd tangent_vector;
 	Eigen::VectorXd n_vector;
 	
@@ -148,9 +203,8 @@ void cBirdScenario::UpdateCharacter()
 
 	offset_vector << 0.01, 0.01, 0.01;
 
-	// Get Tangent and Normal information
-	mCurve.EvalTangent(curr_time, tangent_vector); // T = P' vector
-	mCurve.EvalNormal(curr_time, n_vector);  // P'' vector
+	// Get Position, Tangent and Normal information
+	mCursor.EvalFrame(pos_data, tangent_vector, n_vector); // P, T = P' and P'' vectors
 
 	// Turn these vectors into 3D vectors
 	tangent_vector_used = tangent_vector.segment(0,3);
@@ -173,9 +227,6 @@ void cBirdScenario::UpdateCharacter()
 	binormal_vector = binormal_vector.normalized(); 
 	normal_vector = normal_vector.normalized(); 
 	tangent_vector_used = tangent_vector_used.normalized();
-	
-	Eigen::VectorXd pos_data;
-	mCurve.Eval(curr_time, pos_data);
 
 	tVector pos = tVector(pos_data[0], pos_data[1], pos_data[2], 0);
 	mCharTransform.setIdentity();
@@ -198,18 +249,30 @@ void cBirdScenario::SetupDraw()
 
 void cBirdScenario::SetupShader()
 {
+	mInstanceShader.Bind();
+	SetLightUniforms(mInstanceShader);
+	mShader.Bind();
+	SetLightUniforms(mShader);
+}
+
+void cBirdScenario::SetLightUniforms(cShader& shader)
+{
+	// the shader has to be bound
 	tVector light_dir = tVector(0.1, 1, 0.5, 0).normalized();
 	const tVector light_col = tVector(0.5, 0.5, 0.5, 0);
 	const tVector ambient_col = tVector(0.5, 0.5, 0.5, 0);
 
-	mShader.Bind();
-
 	tMatrix view_mat = mCamera.BuildWorldViewMatrix();
 	light_dir = view_mat * light_dir;
 
-	mShader.setUniform("gLightDir", Eigen::Vector3f(light_dir[0], light_dir[1], light_dir[2]));
-	mShader.setUniform("gLightColour", Eigen::Vector3f(light_col[0], light_col[1], light_col[2]));
-	mShader.setUniform("gAmbientColour", Eigen::Vector3f(ambient_col[0], ambient_col[1], ambient_col[2]));
+	shader.setUniform("gLightDir", Eigen::Vector3f(light_dir[0], light_dir[1], light_dir[2]));
+	shader.setUniform("gLightColour", Eigen::Vector3f(light_col[0], light_col[1], light_col[2]));
+	shader.setUniform("gAmbientColour", Eigen::Vector3f(ambient_col[0], ambient_col[1], ambient_col[2]));
+}
+
+cShader* cBirdScenario::GetInstanceShader()
+{
+	return &mInstanceShader;
 }
 
 void cBirdScenario::DrawScene()
@@ -224,45 +287,34 @@ void cBirdScenario::DrawScene()
 	DrawObjects();
 }
 
+void cBirdScenario::DrawLineMesh(tLineMesh& mesh, GLenum primitive)
+{
+	// nothing has been loaded into the mesh if no curve could be loaded
+	if (mesh.mMesh != nullptr && mesh.mNumVerts > 0)
+	{
+		mesh.mMesh->Draw(primitive, 0, mesh.mNumVerts);
+	}
+}
+
 void cBirdScenario::DrawCurve()
 {
 	cDrawUtil::SetLineWidth(gLineWidth);
 	SetColor(tVector(0, 1, 0, 1));
-	
-	for (int i = 0; i < mCurveSamples.cols() - 1; ++i)
-	{
-		tVector a = tVector(mCurveSamples(0, i), mCurveSamples(1, i), mCurveSamples(2, i), 0);
-		tVector b = tVector(mCurveSamples(0, i + 1), mCurveSamples(1, i + 1), mCurveSamples(2, i + 1), 0);
-		cDrawUtil::DrawLine(a, b);
-	}
+	DrawLineMesh(mCurveMesh, GL_LINE_STRIP);
 }
 
 void cBirdScenario::DrawAnchors()
 {
-	glPointSize(static_cast<GLfloat>(gPointSize));
+	cDrawUtil::SetPointSize(gPointSize);
 	SetColor(tVector(0.1, 0.1, 0.1, 1));
-	
-	int num_anchors = mCurve.GetNumAnchors();
-	for (int i = 0; i < num_anchors; ++i)
-	{
-		const auto& pos = mCurve.GetAnchorPos(i);
-		cDrawUtil::DrawPoint(tVector(pos[0], pos[1], pos[2], 0));
-	}
+	DrawLineMesh(mAnchorMesh, GL_POINTS);
 }
 
 void cBirdScenario::DrawAnchorTangents()
 {
 	cDrawUtil::SetLineWidth(gLineWidth);
 	SetColor(tVector(0, 0, 1, 1));
-	
-	int num_anchors = mCurve.GetNumAnchors();
-	for (int i = 0; i < num_anchors; ++i)
-	{
-		const auto& pos = mCurve.GetAnchorPos(i);
-		const auto& tangent = mCurve.GetAnchorTangent(i);
-		cDrawUtil::DrawLine(tVector(pos[0], pos[1], pos[2], 0), 
-							tVector(pos[0], pos[1], pos[2], 0) + tVector(tangent[0], tangent[1], tangent[2], 0));
-	}
+	DrawLineMesh(mTangentMesh, GL_LINES);
 }
 
 void cBirdScenario::DrawCharacter()
@@ -3,6 +3,7 @@
 #include <nanogui/glutil.h>
 #include "scenarios/Scenario.h"
 #include "Curve.h"
+#include "CurveCursor.h"
 #include "render/Shader.h"
 
 // animates a bird traveling along a curve
@@ -26,12 +27,30 @@ public:
 protected:
 	
 	cShader mShader;
+	cShader mInstanceShader;
 	cCurve mCurve;
+	cCurveCursor mCursor;
 
 	Eigen::MatrixXd mCurveSamples;
 	tMatrix mCharTransform;
 	cDrawMesh mCharMesh;
 
+	// mesh of points or lines that is kept across changes to the curve, only the positions are loaded again
+	// and the normals, texture coordinates and indices are only loaded when the mesh has to grow
+	struct tLineMesh
+	{
+		std::unique_ptr<cDrawMesh> mMesh;
+		int mNumVerts; // vertices that are drawn
+		int mCapacity; // vertices that the normals, texture coordinates and indices have been loaded for
+
+		tLineMesh();
+	};
+
+	// the curve, its anchors and tangents are kept on the GPU and only updated when the curve changes
+	tLineMesh mCurveMesh;
+	tLineMesh mAnchorMesh;
+	tLineMesh mTangentMesh;
+
 	virtual int GetNumAnchors() const;
 	virtual int GetNumCurveSamples() const;
 
@@ -41,14 +60,20 @@ protected:
 	virtual void LoadMesh();
 
 	virtual void UpdateCurve();
+	virtual void BuildCurveMeshes();
+	virtual void UpdateCurveMeshes();
+	virtual void LoadLineMesh(const std::vector<float>& pos_data, tLineMesh& out_mesh) const;
 	virtual void UpdateCharacter();
 
 	virtual void SetColor(const tVector& col);
 
 	virtual void SetupDraw();
 	virtual void SetupShader();
+	virtual void SetLightUniforms(cShader& shader);
+	virtual cShader* GetInstanceShader();
 
 	virtual void DrawScene();
+	virtual void DrawLineMesh(tLineMesh& mesh, GLenum primitive);
 	virtual void DrawCurve();
 	virtual void DrawAnchors();
 	virtual void DrawAnchorTangents();
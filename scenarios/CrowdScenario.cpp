@@ -0,0 +1,303 @@
+#include "scenarios/CrowdScenario.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+#include "render/MeshUtil.h"
+
+const int gDefaultNumChars = 100;
+const int gMaxNumChars = 20000;
+const double gCharSpacing = 1.5; // distance between neighbouring characters
+const double gMinRate = 0.8;
+const double gMaxRate = 1.2;
+const unsigned int gCrowdSeed = 426;
+
+const int gPoseChunkSize = 64; // characters per task handed to the thread pool, a multiple of the FK batch size
+const int gBatchChunkSize = 256;
+const double gTimingSmoothing = 0.9;
+const double gTimingReportPeriod = 2; // seconds between timings printed to the console
+
+const char* gStageNames[cCrowdScenario::eStageMax] =
+{
+	"pose",
+	"fk",
+	"batch",
+	"draw"
+};
+
+cCrowdScenario::tCrowdMember::tCrowdMember()
+{
+	mTimeOffset = 0;
+	mRate = 1;
+	mRootOffset.setZero();
+}
+
+cCrowdScenario::cCrowdScenario()
+{
+	mNumChars = gDefaultNumChars;
+	mPoseSource = ePoseSourceCurve;
+	for (int i = 0; i < eStageMax; ++i)
+	{
+		mStageTimes[i] = 0;
+	}
+}
+
+cCrowdScenario::~cCrowdScenario()
+{
+	mThreadPool.Shutdown();
+}
+
+void cCrowdScenario::Init()
+{
+	// the pool is started first so that the pose cache can be baked on it when the clip is loaded
+	mThreadPool.Init();
+	printf("Crowd scenario using %i threads\n", mThreadPool.GetNumThreads());
+	cBipedScenario::Init();
+
+	cMeshUtil::BuildBoxMesh(mUnitBox);
+
+	BuildMembers();
+	BuildBatches();
+	mLastReport = std::chrono::steady_clock::now();
+}
+
+void cCrowdScenario::LoadParams(const std::string& param_file)
+{
+	cBipedScenario::LoadParams(param_file);
+	if (mChar != nullptr)
+	{
+		// time offsets are spread over the new clip
+		BuildMembers();
+	}
+}
+
+void cCrowdScenario::Update(double time_elapsed)
+{
+	cScenario::Update(time_elapsed);
+	UpdatePoses();
+	UpdateTransforms();
+	UpdateBatches();
+	ReportTimings();
+}
+
+bool cCrowdScenario::IsPoseSourceSupported(ePoseSource source) const
+{
+	// the batched FK of the crowd works on Euler angle poses, so the quaternion keys are not used
+	return cBipedScenario::IsPoseSourceSupported(source) && source != ePoseSourceQuat;
+}
+
+void cCrowdScenario::SetNumChars(int num_chars)
+{
+	mNumChars = std::min(std::max(num_chars, 1), gMaxNumChars);
+	if (mChar != nullptr)
+	{
+		BuildMembers();
+		BuildBatches();
+		UpdatePoses();
+		UpdateTransforms();
+		UpdateBatches();
+	}
+}
+
+int cCrowdScenario::GetNumChars() const
+{
+	return mNumChars;
+}
+
+double cCrowdScenario::GetStageTime(eStage stage) const
+{
+	return mStageTimes[stage];
+}
+
+std::string cCrowdScenario::GetTimingSummary() const
+{
+	std::ostringstream summary;
+	summary << std::fixed << std::setprecision(2);
+	for (int i = 0; i < eStageMax; ++i)
+	{
+		summary << ((i > 0) ? "  " : "") << gStageNames[i] << " " << mStageTimes[i] << "ms";
+	}
+	return summary.str();
+}
+
+void cCrowdScenario::InitCamera()
+{
+	double h = 8;
+	double w = (h * mWinSize.x()) / mWinSize.y();
+	double near_z = 0.1;
+	double far_z = 500;
+
+	mCamera = cCamera(tVector(0, 12, 30, 0), tVector(0, 0.8, 0, 0), tVector(0, 1, 0, 0),
+						w, h, near_z, far_z);
+	mCamera.SetProj(cCamera::eProjPerspective);
+}
+
+void cCrowdScenario::BuildPoseCache()
+{
+	BakePoseCache(&mThreadPool);
+}
+
+void cCrowdScenario::BuildMembers()
+{
+	// characters are placed on a grid centered at the origin,
+	// with random offsets so that the crowd does not move in lockstep
+	std::mt19937 rand_gen(gCrowdSeed);
+	std::uniform_real_distribution<double> rand_unit(0, 1);
+
+	double max_time = mCurve.GetMaxTime();
+	int grid_size = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(mNumChars))));
+	double grid_offset = 0.5 * (grid_size - 1) * gCharSpacing;
+
+	mMembers.resize(mNumChars);
+	mCursors.resize(mNumChars);
+	for (int i = 0; i < mNumChars; ++i)
+	{
+		tCrowdMember& member = mMembers[i];
+		member.mTimeOffset = rand_unit(rand_gen) * max_time;
+		member.mRate = gMinRate + rand_unit(rand_gen) * (gMaxRate - gMinRate);
+
+		int row = i / grid_size;
+		int col = i % grid_size;
+		double jitter_x = (rand_unit(rand_gen) - 0.5) * 0.25 * gCharSpacing;
+		double jitter_z = (rand_unit(rand_gen) - 0.5) * 0.25 * gCharSpacing;
+		member.mRootOffset = tVector(col * gCharSpacing - grid_offset + jitter_x, 0,
+									row * gCharSpacing - grid_offset + jitter_z, 0);
+
+		// every cursor reads from the same curve
+		mCursors[i].SetCurve(&mCurve);
+	}
+
+	int num_joints = mChar->GetNumJoints();
+	mPoses.resize(mCurve.GetDim(), mNumChars);
+	mJointTrans.resize(mNumChars * num_joints);
+	mFKBuffers.resize((mNumChars + gPoseChunkSize - 1) / gPoseChunkSize);
+}
+
+void cCrowdScenario::BuildBatches()
+{
+	// the instance buffer is sized once here and then refilled every frame
+	int num_joints = mChar->GetNumJoints();
+	mLinkTrans.resize(num_joints);
+	for (int j = 0; j < num_joints; ++j)
+	{
+		const cArticulatedFigure::tJointDef& joint = mChar->GetJointDef(j);
+		mLinkTrans[j] = cMathUtil::TranslateMat(joint.mLinkAttachPt) * cMathUtil::ScaleMat(joint.mLinkSize);
+	}
+	mInstanceData.assign(mNumChars * num_joints * cDrawMesh::gInstanceSize, 0);
+}
+
+void cCrowdScenario::UpdatePoses()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	int dim = mCurve.GetDim();
+	if (mPoses.rows() != dim)
+	{
+		mPoses.resize(dim, mNumChars);
+	}
+
+	int root_offset = mChar->GetJointParamOffset(0);
+	const cPoseCache* cache = (mPoseSource == ePoseSourceCache) ? mPoseCache.get() : nullptr;
+	mThreadPool.ParallelFor(mNumChars, gPoseChunkSize, [this, root_offset, cache](int beg, int end)
+	{
+		Eigen::VectorXd pose;
+		for (int i = beg; i < end; ++i)
+		{
+			const tCrowdMember& member = mMembers[i];
+			double time = mTime * member.mRate + member.mTimeOffset;
+			if (cache != nullptr && cache->GetDim() == mPoses.rows())
+			{
+				// the cache wraps the time around the end of the clip by itself
+				cache->Eval(time, pose);
+			}
+			else
+			{
+				// each cursor loops over the clip and stays coherent with its own previous lookup
+				cCurveCursor& cursor = mCursors[i];
+				cursor.SetTime(time);
+				cursor.Eval(pose);
+			}
+
+			pose.segment(root_offset, 3) += member.mRootOffset.segment(0, 3);
+			mPoses.col(i) = pose;
+		}
+	});
+
+	RecordStageTime(eStagePose, start);
+}
+
+void cCrowdScenario::UpdateTransforms()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	int num_joints = mChar->GetNumJoints();
+	mThreadPool.ParallelFor(mNumChars, gPoseChunkSize, [this, num_joints](int beg, int end)
+	{
+		// chunks start at multiples of the chunk size, so no two tasks share a buffer
+		cArticulatedFigure::tFKBatchBuffer& buffer = mFKBuffers[beg / gPoseChunkSize];
+		mChar->ComputeFKBatch(mPoses, beg, end - beg, buffer, mJointTrans.data() + beg * num_joints);
+	});
+
+	RecordStageTime(eStageFK, start);
+}
+
+void cCrowdScenario::UpdateBatches()
+{
+	// packs the world transform of every link into the instance data,
+	// the box faces are axis aligned, so the link scale does not change the direction of the normals
+	auto start = std::chrono::steady_clock::now();
+
+	int num_joints = mChar->GetNumJoints();
+	mThreadPool.ParallelFor(mNumChars, gBatchChunkSize, [this, num_joints](int beg, int end)
+	{
+		for (int i = beg; i < end; ++i)
+		{
+			for (int j = 0; j < num_joints; ++j)
+			{
+				int idx = i * num_joints + j;
+				const tMatrix& joint_trans = mJointTrans[idx];
+				cDrawUtil::PackInstance(joint_trans * mLinkTrans[j], mChar->GetJointDef(j).mCol,
+										mInstanceData.data() + idx * cDrawMesh::gInstanceSize);
+			}
+		}
+	});
+
+	RecordStageTime(eStageBatch, start);
+}
+
+void cCrowdScenario::DrawGround()
+{
+	double size = std::max(100.0, 2 * std::sqrt(static_cast<double>(mNumChars)) * gCharSpacing + 50);
+	SetColor(tVector(0.7, 0.7, 0.7, 1));
+	cDrawUtil::DrawPlane(tVector(0, 1, 0, 0), size);
+}
+
+void cCrowdScenario::DrawCharacter()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	int num_instances = static_cast<int>(mInstanceData.size()) / cDrawMesh::gInstanceSize;
+	mInstanceShader.Bind();
+	mUnitBox->DrawInstances(num_instances, mInstanceData.data());
+	mShader.Bind();
+
+	RecordStageTime(eStageDraw, start);
+}
+
+void cCrowdScenario::RecordStageTime(eStage stage, const std::chrono::steady_clock::time_point& start)
+{
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count();
+	mStageTimes[stage] = gTimingSmoothing * mStageTimes[stage] + (1 - gTimingSmoothing) * ms;
+}
+
+void cCrowdScenario::ReportTimings()
+{
+	auto now = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration<double>(now - mLastReport).count();
+	if (elapsed >= gTimingReportPeriod)
+	{
+		printf("Crowd %i chars: %s\n", mNumChars, GetTimingSummary().c_str());
+		mLastReport = now;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include "scenarios/BipedScenario.h"
+#include "util/ThreadPool.h"
+
+// animates a crowd of bipeds that share the keyframe curves of the biped scenario
+// each character plays the clip with its own time offset, playback rate and root offset,
+// poses and joint transforms are updated on a thread pool and the links are drawn as instances of a unit box,
+// poses can also be blended from the baked pose cache of the clip, which every character shares
+
+class PLUGIN_EXPORT cCrowdScenario : public cBipedScenario
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	enum eStage
+	{
+		eStagePose,
+		eStageFK,
+		eStageBatch,
+		eStageDraw,
+		eStageMax
+	};
+
+	cCrowdScenario();
+	virtual ~cCrowdScenario();
+
+	virtual void Init();
+	virtual void LoadParams(const std::string& param_file);
+
+	virtual void Update(double time_elapsed);
+
+	virtual bool IsPoseSourceSupported(ePoseSource source) const;
+
+	virtual void SetNumChars(int num_chars);
+	virtual int GetNumChars() const;
+	virtual double GetStageTime(eStage stage) const;
+	virtual std::string GetTimingSummary() const;
+
+protected:
+	struct tCrowdMember
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		double mTimeOffset;
+		double mRate;
+		tVector mRootOffset;
+
+		tCrowdMember();
+	};
+
+	int mNumChars;
+	std::vector<tCrowdMember, Eigen::aligned_allocator<tCrowdMember>> mMembers;
+	std::vector<cCurveCursor> mCursors;
+
+	// pose of each character, stored as dim x num chars
+	Eigen::MatrixXd mPoses;
+	// world transforms of every joint, the transforms of character i start at i * num joints
+	std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mJointTrans;
+	// scratch storage of the batched FK, one buffer per chunk of characters handed to the thread pool
+	std::vector<cArticulatedFigure::tFKBatchBuffer> mFKBuffers;
+
+	cThreadPool mThreadPool;
+
+	// every link is a scaled unit box, so the links of the whole crowd are drawn with one instanced draw call
+	std::unique_ptr<cDrawMesh> mUnitBox;
+	tMatrixArr mLinkTrans;
+	// instance data of every link, the links of character i start at i * num joints
+	std::vector<float> mInstanceData;
+
+	double mStageTimes[eStageMax]; // smoothed time of each stage per frame in ms
+	std::chrono::steady_clock::time_point mLastReport;
+
+	virtual void InitCamera();
+
+	virtual void BuildPoseCache();
+	virtual void BuildMembers();
+	virtual void BuildBatches();
+
+	virtual void UpdatePoses();
+	virtual void UpdateTransforms();
+	virtual void UpdateBatches();
+
+	virtual void DrawGround();
+	virtual void DrawCharacter();
+
+	virtual void RecordStageTime(eStage stage, const std::chrono::steady_clock::time_point& start);
+	virtual void ReportTimings();
+};
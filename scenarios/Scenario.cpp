@@ -4,6 +4,7 @@
 cScenario::cScenario()
 {
 	mTime = 0;
+	mEnableDeferredDraw = true;
 	mWinSize.setZero();
 }
 
@@ -37,7 +38,16 @@ void cScenario::Update(double time_elapsed)
 void cScenario::Draw()
 {
 	SetupDraw();
+	bool deferred = mEnableDeferredDraw;
+	if (deferred)
+	{
+		cDrawUtil::BeginDeferred(GetInstanceShader());
+	}
 	DrawScene();
+	if (deferred)
+	{
+		cDrawUtil::FlushDeferred();
+	}
 }
 
 void cScenario::Resize(const Eigen::Vector2i& win_size)
@@ -99,6 +109,16 @@ void cScenario::SetPlaybackProgress(double val)
 {
 }
 
+void cScenario::EnableDeferredDraw(bool enable)
+{
+	mEnableDeferredDraw = enable;
+}
+
+bool cScenario::EnableDeferredDraw() const
+{
+	return mEnableDeferredDraw;
+}
+
 
 void cScenario::InitCamera()
 {
@@ -134,6 +154,12 @@ void cScenario::DrawScene()
 	cDrawUtil::ClearColor(GetClearColor());
 }
 
+cShader* cScenario::GetInstanceShader()
+{
+	// primitives are still recorded and sorted without an instance shader, but each one is drawn on its own
+	return nullptr;
+}
+
 tVector cScenario::GetClearColor() const
 {
 	return tVector(0.25, 0.25, 0.25, 0);
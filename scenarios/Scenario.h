@@ -4,6 +4,8 @@
 
 #include "render/Camera.h"
 
+class cShader;
+
 class PLUGIN_EXPORT cScenario
 {
 public:
@@ -30,8 +32,13 @@ public:
 	virtual double GetPlaybackProgress() const;
 	virtual void SetPlaybackProgress(double val);
 
+	// records the primitives of a frame and draws them in batches once the scene is done
+	virtual void EnableDeferredDraw(bool enable);
+	virtual bool EnableDeferredDraw() const;
+
 protected:
 	double mTime;
+	bool mEnableDeferredDraw;
 	Eigen::Vector2i mWinSize;
 	std::vector<std::string> mParamFiles;
 
@@ -44,6 +51,7 @@ protected:
 
 	virtual void SetupDraw();
 	virtual void DrawScene();
+	virtual cShader* GetInstanceShader();
 
 	virtual tVector GetClearColor() const;
 };
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <string>
+#include "Curve.h"
+
+// converts curve parameter files from JSON to the binary curve format,
+// binary curves are loaded by cCurve::Load in the same way as JSON curves
+// usage: CurveConverter <input file> <output file>
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		printf("Usage: %s <input curve file> <output binary curve file>\n", argv[0]);
+		return 1;
+	}
+
+	std::string in_file = argv[1];
+	std::string out_file = argv[2];
+
+	cCurve curve;
+	bool succ = curve.Load(in_file);
+	if (!succ)
+	{
+		printf("Failed to load curve from %s\n", in_file.c_str());
+		return 1;
+	}
+
+	succ = curve.SaveBinary(out_file);
+	if (!succ)
+	{
+		printf("Failed to save curve to %s\n", out_file.c_str());
+		return 1;
+	}
+
+	printf("Converted %s to %s (%i anchors, dim %i)\n", in_file.c_str(), out_file.c_str(),
+			curve.GetNumAnchors(), curve.GetDim());
+	return 0;
+}
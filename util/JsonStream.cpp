@@ -0,0 +1,193 @@
+#include "JsonStream.h"
+#include <cstdlib>
+#include <cstdio>
+
+cJsonStream::cJsonStream(const char* data, size_t size)
+{
+	mData = data;
+	mSize = size;
+	mPos = 0;
+}
+
+cJsonStream::~cJsonStream()
+{
+}
+
+bool cJsonStream::Peek(char c)
+{
+	// checks if the next token starts with c without consuming it
+	SkipWhitespace();
+	return (mPos < mSize) && (mData[mPos] == c);
+}
+
+bool cJsonStream::Consume(char c)
+{
+	bool succ = Peek(c);
+	if (succ)
+	{
+		++mPos;
+	}
+	return succ;
+}
+
+bool cJsonStream::ReadString(std::string& out_str)
+{
+	// escape sequences are kept as is, which is sufficient for keys and enum values
+	bool succ = Consume('"');
+	if (succ)
+	{
+		size_t beg = mPos;
+		while (mPos < mSize && mData[mPos] != '"')
+		{
+			if (mData[mPos] == '\\')
+			{
+				++mPos;
+			}
+			++mPos;
+		}
+
+		succ = mPos < mSize;
+		if (succ)
+		{
+			out_str.assign(mData + beg, mPos - beg);
+			++mPos;
+		}
+	}
+	return succ;
+}
+
+bool cJsonStream::ReadNumber(double& out_val)
+{
+	// the document is expected to be terminated by a non-numeric character,
+	// e.g. the null terminator of a std::string, so strtod cannot run past the end
+	SkipWhitespace();
+	const char* beg = mData + mPos;
+	char* end = nullptr;
+	out_val = std::strtod(beg, &end);
+
+	bool succ = (end != beg) && (end <= mData + mSize);
+	if (succ)
+	{
+		mPos += end - beg;
+	}
+	return succ;
+}
+
+bool cJsonStream::ReadNumberArray(double* out_vals, int max_count, int& out_count)
+{
+	// writes the numbers in an array to out_vals without any intermediate storage,
+	// numbers past max_count are only counted, so out_count can be checked against the expected size
+	out_count = 0;
+	bool succ = Consume('[');
+	if (succ && !Consume(']'))
+	{
+		do
+		{
+			double val = 0;
+			succ = ReadNumber(val);
+			if (succ)
+			{
+				if (out_count < max_count)
+				{
+					out_vals[out_count] = val;
+				}
+				++out_count;
+			}
+		} while (succ && Consume(','));
+
+		succ = succ && Consume(']');
+	}
+	return succ;
+}
+
+bool cJsonStream::SkipValue()
+{
+	// skips over the next value, including any nested arrays and objects
+	SkipWhitespace();
+	bool succ = mPos < mSize;
+	if (succ)
+	{
+		char c = mData[mPos];
+		if (c == '"')
+		{
+			std::string str;
+			succ = ReadString(str);
+		}
+		else if (c == '[' || c == '{')
+		{
+			int depth = 0;
+			while (mPos < mSize)
+			{
+				c = mData[mPos];
+				if (c == '"')
+				{
+					std::string str;
+					succ = ReadString(str);
+					if (!succ)
+					{
+						break;
+					}
+					continue;
+				}
+
+				++mPos;
+				if (c == '[' || c == '{')
+				{
+					++depth;
+				}
+				else if (c == ']' || c == '}')
+				{
+					--depth;
+					if (depth == 0)
+					{
+						break;
+					}
+				}
+			}
+			succ = succ && (depth == 0);
+		}
+		else
+		{
+			// numbers, true, false and null
+			while (mPos < mSize)
+			{
+				c = mData[mPos];
+				if (c == ',' || c == ']' || c == '}' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+				{
+					break;
+				}
+				++mPos;
+			}
+		}
+	}
+	return succ;
+}
+
+size_t cJsonStream::GetPos() const
+{
+	return mPos;
+}
+
+void cJsonStream::SetPos(size_t pos)
+{
+	mPos = pos;
+}
+
+bool cJsonStream::AtEnd()
+{
+	SkipWhitespace();
+	return mPos >= mSize;
+}
+
+void cJsonStream::SkipWhitespace()
+{
+	while (mPos < mSize)
+	{
+		char c = mData[mPos];
+		if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+		{
+			break;
+		}
+		++mPos;
+	}
+}
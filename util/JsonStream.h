@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include "PluginAPI.h"
+
+// forward-only reader over a JSON document held in memory
+// values are consumed one token at a time without building a tree,
+// which allows large numeric arrays to be parsed straight into their final storage
+
+class PLUGIN_EXPORT cJsonStream
+{
+public:
+	cJsonStream(const char* data, size_t size);
+	virtual ~cJsonStream();
+
+	virtual bool Peek(char c);
+	virtual bool Consume(char c);
+	virtual bool ReadString(std::string& out_str);
+	virtual bool ReadNumber(double& out_val);
+	virtual bool ReadNumberArray(double* out_vals, int max_count, int& out_count);
+	virtual bool SkipValue();
+
+	virtual size_t GetPos() const;
+	virtual void SetPos(size_t pos);
+	virtual bool AtEnd();
+
+protected:
+	const char* mData;
+	size_t mSize;
+	size_t mPos;
+
+	virtual void SkipWhitespace();
+};
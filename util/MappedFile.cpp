@@ -0,0 +1,134 @@
+#include "MappedFile.h"
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+cMappedFile::cMappedFile()
+{
+	mData = nullptr;
+	mSize = 0;
+#if defined(_WIN32)
+	mFileHandle = INVALID_HANDLE_VALUE;
+	mMappingHandle = nullptr;
+#endif
+}
+
+cMappedFile::~cMappedFile()
+{
+	Close();
+}
+
+bool cMappedFile::Open(const std::string& file)
+{
+	Close();
+	bool succ = true;
+
+#if defined(_WIN32)
+	mFileHandle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+								OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	succ = mFileHandle != INVALID_HANDLE_VALUE;
+
+	LARGE_INTEGER size;
+	if (succ)
+	{
+		succ = GetFileSizeEx(mFileHandle, &size) != 0 && size.QuadPart > 0;
+	}
+
+	if (succ)
+	{
+		mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		succ = mMappingHandle != nullptr;
+	}
+
+	if (succ)
+	{
+		mData = static_cast<const char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+		mSize = static_cast<size_t>(size.QuadPart);
+		succ = mData != nullptr;
+	}
+#else
+	int fd = open(file.c_str(), O_RDONLY);
+	succ = fd >= 0;
+
+	struct stat file_stat;
+	if (succ)
+	{
+		succ = (fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0);
+	}
+
+	if (succ)
+	{
+		void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		succ = data != MAP_FAILED;
+		if (succ)
+		{
+			mData = static_cast<const char*>(data);
+			mSize = static_cast<size_t>(file_stat.st_size);
+		}
+	}
+
+	// the mapping stays valid after the file is closed
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+#endif
+
+	if (!succ)
+	{
+		printf("Failed to map file %s\n", file.c_str());
+		Close();
+	}
+
+	return succ;
+}
+
+void cMappedFile::Close()
+{
+#if defined(_WIN32)
+	if (mData != nullptr)
+	{
+		UnmapViewOfFile(mData);
+	}
+	if (mMappingHandle != nullptr)
+	{
+		CloseHandle(mMappingHandle);
+		mMappingHandle = nullptr;
+	}
+	if (mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFileHandle);
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mData != nullptr)
+	{
+		munmap(const_cast<char*>(mData), mSize);
+	}
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+bool cMappedFile::IsOpen() const
+{
+	return mData != nullptr;
+}
+
+const char* cMappedFile::GetData() const
+{
+	return mData;
+}
+
+size_t cMappedFile::GetSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include "PluginAPI.h"
+
+// read-only memory mapping of a file
+// the contents of the file are paged in by the os on first access,
+// so large files can be used directly without being read into memory first
+
+class PLUGIN_EXPORT cMappedFile
+{
+public:
+	cMappedFile();
+	virtual ~cMappedFile();
+
+	virtual bool Open(const std::string& file);
+	virtual void Close();
+	virtual bool IsOpen() const;
+
+	virtual const char* GetData() const;
+	virtual size_t GetSize() const;
+
+protected:
+	const char* mData;
+	size_t mSize;
+
+#if defined(_WIN32)
+	void* mFileHandle;
+	void* mMappingHandle;
+#endif
+
+private:
+	// mappings cannot be copied, since the destructor unmaps the file
+	cMappedFile(const cMappedFile& other);
+	cMappedFile& operator=(const cMappedFile& other);
+};
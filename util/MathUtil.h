@@ -14,6 +14,7 @@ typedef Eigen::Vector4d tVector3;
 typedef Eigen::Matrix4d tMatrix;
 typedef Eigen::Matrix3d tMatrix3;
 typedef std::vector<tVector, Eigen::aligned_allocator<tVector>> tVectorArr;
+typedef std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> tMatrixArr;
 typedef Eigen::Quaterniond tQuaternion;
 
 const double gRadiansToDegrees = 57.2957795;
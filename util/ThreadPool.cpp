@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+cThreadPool::cThreadPool()
+{
+	mJobFunc = nullptr;
+	mJobID = 0;
+	mJobNumItems = 0;
+	mJobChunkSize = 1;
+	mJobNextItem = 0;
+	mNumActiveWorkers = 0;
+	mDone = false;
+}
+
+cThreadPool::~cThreadPool()
+{
+	Shutdown();
+}
+
+void cThreadPool::Init(int num_threads)
+{
+	// num_threads includes the calling thread, 0 uses one thread per hardware thread
+	Shutdown();
+
+	if (num_threads <= 0)
+	{
+		num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	mDone = false;
+	for (int i = 0; i < num_threads - 1; ++i)
+	{
+		// new workers only pick up jobs posted after Init
+		mWorkers.push_back(std::thread(&cThreadPool::WorkerLoop, this, mJobID));
+	}
+}
+
+void cThreadPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mDone = true;
+	}
+	mWorkCond.notify_all();
+
+	for (size_t i = 0; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i].join();
+	}
+	mWorkers.clear();
+}
+
+int cThreadPool::GetNumThreads() const
+{
+	return static_cast<int>(mWorkers.size()) + 1;
+}
+
+void cThreadPool::ParallelFor(int num_items, int chunk_size, const tRangeFunc& func)
+{
+	chunk_size = std::max(1, chunk_size);
+	if (mWorkers.empty() || num_items <= chunk_size)
+	{
+		// not worth waking up the workers
+		if (num_items > 0)
+		{
+			func(0, num_items);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobFunc = &func;
+		mJobNumItems = num_items;
+		mJobChunkSize = chunk_size;
+		mJobNextItem = 0;
+		mNumActiveWorkers = static_cast<int>(mWorkers.size());
+		++mJobID;
+	}
+	mWorkCond.notify_all();
+
+	ProcessChunks(func, num_items, chunk_size);
+
+	// the job has to outlive every worker that is still processing a chunk
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCond.wait(lock, [this]() { return mNumActiveWorkers == 0; });
+	mJobFunc = nullptr;
+}
+
+void cThreadPool::WorkerLoop(int last_job_id)
+{
+	while (true)
+	{
+		const tRangeFunc* func = nullptr;
+		int num_items = 0;
+		int chunk_size = 1;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkCond.wait(lock, [this, last_job_id]() { return mDone || mJobID != last_job_id; });
+			if (mDone)
+			{
+				break;
+			}
+
+			last_job_id = mJobID;
+			func = mJobFunc;
+			num_items = mJobNumItems;
+			chunk_size = mJobChunkSize;
+		}
+
+		ProcessChunks(*func, num_items, chunk_size);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mNumActiveWorkers;
+		}
+		mDoneCond.notify_one();
+	}
+}
+
+void cThreadPool::ProcessChunks(const tRangeFunc& func, int num_items, int chunk_size)
+{
+	while (true)
+	{
+		int beg = mJobNextItem.fetch_add(chunk_size);
+		if (beg >= num_items)
+		{
+			break;
+		}
+		int end = std::min(beg + chunk_size, num_items);
+		func(beg, end);
+	}
+}
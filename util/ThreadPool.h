@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include "PluginAPI.h"
+
+// fixed set of worker threads for data parallel loops
+// ParallelFor splits a range of items into chunks that are handed out to the workers
+// and the calling thread, and returns once every item has been processed
+
+class PLUGIN_EXPORT cThreadPool
+{
+public:
+	// processes the items in [beg, end)
+	typedef std::function<void(int beg, int end)> tRangeFunc;
+
+	cThreadPool();
+	virtual ~cThreadPool();
+
+	virtual void Init(int num_threads = 0);
+	virtual void Shutdown();
+	virtual int GetNumThreads() const;
+
+	virtual void ParallelFor(int num_items, int chunk_size, const tRangeFunc& func);
+
+protected:
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWorkCond;
+	std::condition_variable mDoneCond;
+
+	// the current job, workers pick up a new job whenever mJobID changes
+	const tRangeFunc* mJobFunc;
+	int mJobID;
+	int mJobNumItems;
+	int mJobChunkSize;
+	std::atomic<int> mJobNextItem;
+	int mNumActiveWorkers;
+	bool mDone;
+
+	virtual void WorkerLoop(int last_job_id);
+	virtual void ProcessChunks(const tRangeFunc& func, int num_items, int chunk_size);
+
+private:
+	cThreadPool(const cThreadPool& other);
+	cThreadPool& operator=(const cThreadPool& other);
+};